@@ -5,25 +5,197 @@
 
 #include <stdio.h>
 #include "acia.h"
+#include "clkcnt.h"
+#include "irq.h"
 
 /*
- * serial transmit character
+ * write a character straight to the tx FIFO
  */
-void acia_putc(char c)
+static void acia_fifo_putc(char c)
 {
-	/* wait for tx ready */
-	while(!(acia_ctlstat & 2));
+	/* wait for tx FIFO space */
+	while(!(acia_ctlstat & ACIA_ST_TXNF));
 	
 	/* send char */
 	acia_data = c;
 }
 
+#ifndef BOOT
+/* control reg - shadowed as it can't be read back */
+#define ACIA_CTL_TXIE 0x20		// IRQ while tx level < threshold
+#define ACIA_CTL_RXIE 0x80		// IRQ while rx level >= threshold
+static uint8_t acia_ctl;
+
+/* optional transmit ring, drained into the FIFO by the tx IRQ. The
+   bootloader has no ring and writes the FIFO directly */
+static struct
+{
+	uint8_t *buf;
+	uint32_t size;
+	volatile uint32_t head;	// next free slot
+	volatile uint32_t tail;	// next to send
+	uint32_t drops;			// bytes lost with ACIA_TX_DROP
+	uint8_t policy;
+} acia_tx;
+
+/*
+ * move the ring into the tx FIFO, IRQ on while anything is left
+ */
+static void acia_tx_fill(void)
+{
+	uint32_t space = ACIA_TX_DEPTH - acia_txlvl;
+	uint32_t tail = acia_tx.tail;
+	uint8_t ctl;
+	
+	while(space-- && (tail != acia_tx.head))
+	{
+		acia_data = acia_tx.buf[tail];
+		if(++tail == acia_tx.size)
+			tail = 0;
+	}
+	acia_tx.tail = tail;
+	
+	ctl = (tail == acia_tx.head) ? acia_ctl & ~ACIA_CTL_TXIE :
+		acia_ctl | ACIA_CTL_TXIE;
+	if(ctl != acia_ctl)
+		acia_ctlstat = acia_ctl = ctl;
+}
+
+/*
+ * tx threshold interrupt
+ */
+static void acia_isr(void)
+{
+	acia_tx_fill();
+}
+
+/*
+ * put stdout through a ring in RAM so printf doesn't wait on the port.
+ * A full ring drops bytes or waits for room according to policy. A NULL
+ * buffer goes back to writing the FIFO directly.
+ */
+void acia_txbuf_init(uint8_t *buf, uint32_t size, uint8_t policy)
+{
+	acia_flush();
+	
+	acia_tx.buf = (buf && (size > 1)) ? buf : 0;
+	acia_tx.size = size;
+	acia_tx.head = acia_tx.tail = 0;
+	acia_tx.drops = 0;
+	acia_tx.policy = policy;
+	
+	if(acia_tx.buf)
+		irq_register(IRQ_ACIA, acia_isr);
+}
+
+/*
+ * queue a character - straight into the FIFO if nothing is waiting or
+ * there's no ring
+ */
+void acia_txbuf_putc(char c)
+{
+	uint32_t mask, head, next;
+	
+	if(!acia_tx.buf)
+	{
+		acia_fifo_putc(c);
+		return;
+	}
+	
+	mask = irq_save();
+	if((acia_tx.head == acia_tx.tail) && (acia_ctlstat & ACIA_ST_TXNF))
+	{
+		acia_data = c;
+		irq_restore(mask);
+		return;
+	}
+	
+	while(1)
+	{
+		head = acia_tx.head;
+		next = (head + 1 == acia_tx.size) ? 0 : head + 1;
+		if(next != acia_tx.tail)
+			break;
+		
+		if(acia_tx.policy == ACIA_TX_DROP)
+		{
+			acia_tx.drops++;
+			irq_restore(mask);
+			return;
+		}
+		
+		/* let the IRQ in, then drain it ourselves in case we're in one */
+		irq_restore(mask);
+		mask = irq_save();
+		acia_tx_fill();
+	}
+	
+	acia_tx.buf[head] = c;
+	acia_tx.head = next;
+	acia_tx_fill();
+	irq_restore(mask);
+}
+
+/*
+ * wait for the ring and FIFO to empty
+ */
+void acia_flush(void)
+{
+	uint32_t mask;
+	
+	while(acia_tx.buf && (acia_tx.head != acia_tx.tail))
+	{
+		mask = irq_save();
+		acia_tx_fill();
+		irq_restore(mask);
+	}
+	while(!(acia_ctlstat & ACIA_ST_TXIDLE));
+}
+
+/*
+ * bytes dropped from a full ring, clears the count
+ */
+uint32_t acia_tx_drops(void)
+{
+	uint32_t mask = irq_save(), n = acia_tx.drops;
+	
+	acia_tx.drops = 0;
+	irq_restore(mask);
+	
+	return n;
+}
+#else
+/*
+ * no ring in the bootloader
+ */
+void acia_txbuf_putc(char c)
+{
+	acia_fifo_putc(c);
+}
+
+/*
+ * wait for the FIFO to empty
+ */
+void acia_flush(void)
+{
+	while(!(acia_ctlstat & ACIA_ST_TXIDLE));
+}
+#endif
+
+/*
+ * serial transmit character, behind anything already in the ring
+ */
+void acia_putc(char c)
+{
+	acia_txbuf_putc(c);
+}
+
 /*
  * output for tiny printf
  */
 void acia_printf_putc(void* p, char c)
 {
-	acia_putc(c);
+	acia_txbuf_putc(c);
 }
 
 /*
@@ -42,8 +214,99 @@ void acia_puts(char *str)
  */
 int acia_getc(void)
 {
-	if(!(acia_ctlstat & 1))
+	if(!(acia_ctlstat & ACIA_ST_RXF))
 		return EOF;
 	else
 		return acia_data;
 }
+
+/*
+ * serial transmit buffer - fills the tx FIFO in bursts, or queues behind
+ * the ring when there is one
+ */
+void acia_write(uint8_t *buf, uint32_t len)
+{
+	uint32_t space;
+	
+#ifndef BOOT
+	if(acia_tx.buf)
+	{
+		while(len--)
+			acia_txbuf_putc(*buf++);
+		return;
+	}
+#endif
+	
+	while(len)
+	{
+		/* wait for room */
+		while(!(space = ACIA_TX_DEPTH - acia_txlvl));
+		
+		/* fill it */
+		if(space > len)
+			space = len;
+		len -= space;
+		while(space--)
+			acia_data = *buf++;
+	}
+}
+
+/*
+ * serial receive buffer - returns number of bytes read, doesn't block
+ */
+uint32_t acia_read(uint8_t *buf, uint32_t len)
+{
+	uint32_t avail;
+	
+	avail = acia_rxlvl;
+	if(avail > len)
+		avail = len;
+	len = avail;
+	while(avail--)
+		*buf++ = acia_data;
+	
+	return len;
+}
+
+/*
+ * rx bytes dropped because the FIFO was full, clears the count
+ */
+uint8_t acia_overruns(void)
+{
+	uint8_t ovr = acia_ovr;
+	
+	acia_ovr = 0;
+	
+	return ovr;
+}
+
+/*
+ * change bit rate once the transmitter has drained. Returns the rate
+ * actually set or 0 if it's out of range. Both ends must be switched.
+ */
+uint32_t acia_set_baud(uint32_t baud)
+{
+	uint32_t div;
+	
+	if(!baud)
+		return 0;
+	div = (16*CLKCNT_HZ + baud/2) / baud;
+	if((div < ACIA_DIV_MIN) || (div > ACIA_DIV_MAX))
+		return 0;
+	
+	acia_flush();
+	acia_divlo = div & 0xff;
+	acia_divhi = div >> 8;
+	
+	return (16*CLKCNT_HZ + div/2) / div;
+}
+
+/*
+ * current bit rate
+ */
+uint32_t acia_get_baud(void)
+{
+	uint32_t div = acia_divlo | (acia_divhi << 8);
+	
+	return (16*CLKCNT_HZ + div/2) / div;
+}
@@ -8,10 +8,41 @@
 
 #include "up5k_riscv.h"
 
+/* FIFO depths - must match RX_AW/TX_AW in acia.v */
+#define ACIA_RX_DEPTH 128
+#define ACIA_TX_DEPTH 128
+
+/* status bits */
+#define ACIA_ST_RXF 0x01
+#define ACIA_ST_TXNF 0x02
+#define ACIA_ST_TXIDLE 0x04
+#define ACIA_ST_TXTHR 0x08
+#define ACIA_ST_FRM 0x10
+#define ACIA_ST_OVR 0x20
+#define ACIA_ST_RXTHR 0x40
+#define ACIA_ST_IRQ 0x80
+
+/* full transmit ring policy */
+#define ACIA_TX_DROP 0
+#define ACIA_TX_BLOCK 1
+
+/* baud divisor is 16*clk/baud, 128 is the fastest it runs */
+#define ACIA_DIV_MIN 128
+#define ACIA_DIV_MAX 0xffff
+
 void acia_putc(char c);
 void acia_printf_putc(void* p, char c);
 void acia_puts(char *str);
 int acia_getc(void);
+void acia_write(uint8_t *buf, uint32_t len);
+uint32_t acia_read(uint8_t *buf, uint32_t len);
+uint8_t acia_overruns(void);
+uint32_t acia_set_baud(uint32_t baud);
+uint32_t acia_get_baud(void);
+void acia_txbuf_init(uint8_t *buf, uint32_t size, uint8_t policy);
+void acia_txbuf_putc(char c);
+void acia_flush(void);
+uint32_t acia_tx_drops(void);
 
 #endif
 
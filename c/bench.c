@@ -0,0 +1,221 @@
+/*
+ * bench.c - firmware benchmark suite for the icarus testbench
+ * 10-17-26 E. Brombaugh
+ *
+ * Built into main with BENCH=suite and run by make bench in the icarus
+ * directory. Sizes are kept small so the whole suite simulates in a
+ * few ms - each region is repeated to show the spread. The flash program
+ * and erase regions also check their results, so the suite doubles as a
+ * test of the firmware write path against the flash model. The xip region
+ * checks that code placed with __xip runs from flash through the cache.
+ * The spi dma region runs SB_SPI1 through the DMA engine to the
+ * testbench's checking slave on CS1. Here it checks the slave's
+ * incrementing reply in SPRAM, and the testbench checks that the slave
+ * got the source buffer. The i2c region runs once at 100kHz against the
+ * testbench's memory at 0x1A: a write, a read back after a repeated start,
+ * a single byte read and a write to an address nobody answers. The
+ * testbench checks that each read ended with a NACK on its last byte.
+ */
+
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "spi.h"
+#include "flash.h"
+#include "ili9341.h"
+#include "i2c.h"
+
+enum
+{
+	B_MEMCPY,
+	B_PRINTF_X,
+	B_PRINTF_D,
+	B_FILLRECT,
+	B_FLASH,
+	B_HSV2RGB,
+	B_LINE,
+	B_HLINE,
+	B_PROGRAM,
+	B_ERASE,
+	B_XIP,
+	B_DMA,
+	B_I2C,
+};
+
+#define BENCH_RUNS 4
+#define BENCH_BYTES 4096
+#define BENCH_PROG 1024
+#define BENCH_FLASH 0x200000	// scratch sector, clear of XIP, boot & kvs
+#define BENCH_DMA 1024
+#define BENCH_I2C 0x1A			// testbench I2C memory
+#define BENCH_I2C_NONE 0x2B		// nothing here
+
+static uint32_t bench_src[BENCH_BYTES/4], bench_dst[BENCH_BYTES/4];
+
+/*
+ * rotate & xor checksum, run from ROM and from the XIP window
+ */
+static inline uint32_t bench_sum(const uint32_t *p, uint32_t n)
+{
+	uint32_t sum = 0;
+	
+	while(n--)
+		sum = ((sum<<1) | (sum>>31)) ^ *p++;
+	
+	return sum;
+}
+
+static uint32_t __xip __attribute__ ((noinline))
+	bench_sum_xip(const uint32_t *p, uint32_t n)
+{
+	return bench_sum(p, n);
+}
+
+/*
+ * run each region BENCH_RUNS times then report
+ */
+void bench_suite(void)
+{
+	char bf[16];
+	uint8_t hsv[3], rgb[3], *tx, *rx, wb[5], rb[4];
+	spi_dev dma_dev;
+	uint32_t i, j, h, m;
+	int ok;
+	
+	bench_name(B_MEMCPY, "memcpy 4k");
+	bench_name(B_PRINTF_X, "printf %08X");
+	bench_name(B_PRINTF_D, "printf %d");
+	bench_name(B_FILLRECT, "fillRect 32x32");
+	bench_name(B_FLASH, "flash_read 4k");
+	bench_name(B_HSV2RGB, "hsv2rgb x64");
+	bench_name(B_LINE, "drawLine 64");
+	bench_name(B_HLINE, "drawFastHLine 64");
+	bench_name(B_PROGRAM, "flash_program 1k");
+	bench_name(B_ERASE, "flash_erase 4k");
+	bench_name(B_XIP, "xip sum 1k");
+	bench_name(B_DMA, "spi dma 1k");
+	bench_name(B_I2C, "i2c 100k");
+	
+	spi_init(SPI0);
+	spi_init(SPI1);
+	flash_init(SPI0);
+	ili9341_init(SPI1);
+	spi_dev_init(&dma_dev, SPI1, 1, 0x02, SPI_MODE0);
+	i2c_init(I2C0);
+	
+	for(i=0;i<BENCH_BYTES/4;i++)
+		bench_src[i] = i * 0x9E3779B9;
+	
+	/* both halves of bench_dst, byte n of the source is ~n for the slave */
+	tx = (uint8_t *)bench_dst;
+	rx = tx + BENCH_DMA;
+	
+	m = xip_misses;
+	for(i=0;i<BENCH_RUNS;i++)
+	{
+		bench_start(B_MEMCPY);
+		memcpy(bench_dst, bench_src, BENCH_BYTES);
+		bench_stop(B_MEMCPY);
+		
+		bench_start(B_PRINTF_X);
+		sprintf(bf, "%08X", 0x89ABCDEF ^ i);
+		bench_stop(B_PRINTF_X);
+		
+		bench_start(B_PRINTF_D);
+		sprintf(bf, "%d", -1234567890 + (int)i);
+		bench_stop(B_PRINTF_D);
+		
+		bench_start(B_FILLRECT);
+		ili9341_fillRect(i*8, i*8, 32, 32, 0xF800 >> i);
+		bench_stop(B_FILLRECT);
+		
+		bench_start(B_FLASH);
+		flash_read(SPI0, (uint8_t *)bench_dst, 0x100000 + i*BENCH_BYTES,
+			BENCH_BYTES);
+		bench_stop(B_FLASH);
+		
+		bench_start(B_HSV2RGB);
+		hsv[1] = 255;
+		hsv[2] = 255;
+		for(j=0;j<64;j++)
+		{
+			hsv[0] = j*4 + i;
+			ili9341_hsv2rgb(rgb, hsv);
+		}
+		bench_stop(B_HSV2RGB);
+		
+		/* same pixel count, a window per pixel vs one for the lot */
+		bench_start(B_LINE);
+		ili9341_drawLine(i*8, 64, i*8+63, 127, 0x07E0);
+		bench_stop(B_LINE);
+		
+		bench_start(B_HLINE);
+		ili9341_drawFastHLine(i*8, 160+i, 64, 0x001F);
+		bench_stop(B_HLINE);
+		
+		/* the real write path, each time straight after a streamed read
+		   so the stream has to end before the write enable */
+		flash_read(SPI0, (uint8_t *)bench_dst, BENCH_FLASH, 16);
+		bench_start(B_PROGRAM);
+		ok = !flash_program(SPI0, (uint8_t *)bench_src + i*BENCH_PROG,
+			BENCH_FLASH, BENCH_PROG);
+		bench_stop(B_PROGRAM);
+		bench_check(B_PROGRAM, ok);
+		
+		bench_start(B_ERASE);
+		flash_erase(SPI0, BENCH_FLASH, FLASH_SECTOR);
+		bench_stop(B_ERASE);
+		flash_read(SPI0, (uint8_t *)bench_dst, BENCH_FLASH, BENCH_PROG);
+		for(j=0,ok=1;j<BENCH_PROG/4;j++)
+			ok &= (bench_dst[j] == 0xffffffff);
+		bench_check(B_ERASE, ok);
+		
+		/* cold code executing in place, missing on the first run only */
+		h = xip_hits;
+		bench_start(B_XIP);
+		j = bench_sum_xip(bench_src, 256);
+		bench_stop(B_XIP);
+		bench_check(B_XIP, (j == bench_sum(bench_src, 256)) &&
+			(xip_hits != h));
+		
+		for(j=0;j<BENCH_DMA;j++)
+		{
+			tx[j] = ~j;
+			rx[j] = 0;
+		}
+		bench_start(B_DMA);
+		spi_dev_select(&dma_dev);
+		spi_dma_start(SPI1, tx, rx, BENCH_DMA);
+		spi_dma_wait();
+		spi_dev_release(&dma_dev);
+		bench_stop(B_DMA);
+		for(j=1,ok=1;j<BENCH_DMA;j++)
+			ok &= (rx[j] == (uint8_t)(rx[0] + j));
+		bench_check(B_DMA, ok);
+	}
+	bench_check(B_XIP, xip_misses != m);
+	
+	/* pointer then data, read back from the pointer */
+	wb[0] = 0x10;
+	for(j=1;j<5;j++)
+		wb[j] = 0xA0 + j;
+	bench_start(B_I2C);
+	ok = (i2c_tx(I2C0, BENCH_I2C, wb, 5) == I2C_OK);
+	bench_stop(B_I2C);
+	bench_check(B_I2C, ok);
+	
+	bench_start(B_I2C);
+	ok = (i2c_txrx(I2C0, BENCH_I2C, wb, 1, rb, 4) == I2C_OK) &&
+		!memcmp(rb, wb+1, 4);
+	bench_stop(B_I2C);
+	bench_check(B_I2C, ok);
+	
+	wb[0] = 0x13;
+	ok = (i2c_txrx(I2C0, BENCH_I2C, wb, 1, rb, 1) == I2C_OK) &&
+		(rb[0] == wb[4]);
+	bench_check(B_I2C, ok);
+	
+	bench_check(B_I2C, i2c_tx(I2C0, BENCH_I2C_NONE, wb, 1) == I2C_NACK);
+	
+	bench_done();
+}
@@ -0,0 +1,63 @@
+/*
+ * bench.h - benchmark region markers for the icarus testbench
+ * 10-17-26 E. Brombaugh
+ *
+ * Writes to bench_mark are ignored by the hardware. tb_system.v watches
+ * them and reports clocks and CPI per named region, and any failed
+ * bench_check() results, when bench_done() is called. Markers cost one
+ * store so regions of a few hundred clocks are still meaningful.
+ */
+
+#ifndef __bench__
+#define __bench__
+
+#include "up5k_riscv.h"
+
+#define BENCH_REGIONS 16
+
+/* marker commands in [31:28], region in [11:8], name char or check
+   result in [7:0] */
+#define BENCH_START 0x10000000
+#define BENCH_STOP 0x20000000
+#define BENCH_NAME 0x30000000
+#define BENCH_DONE 0x40000000
+#define BENCH_CHECK 0x50000000
+
+/*
+ * label a region in the report
+ */
+static inline void bench_name(uint32_t id, const char *name)
+{
+	while(*name)
+		bench_mark = BENCH_NAME | (id<<8) | (uint8_t)*name++;
+}
+
+static inline void bench_start(uint32_t id)
+{
+	bench_mark = BENCH_START | (id<<8);
+}
+
+static inline void bench_stop(uint32_t id)
+{
+	bench_mark = BENCH_STOP | (id<<8);
+}
+
+/*
+ * record a pass (ok != 0) or fail against a region
+ */
+static inline void bench_check(uint32_t id, int ok)
+{
+	bench_mark = BENCH_CHECK | (id<<8) | (ok != 0);
+}
+
+/*
+ * print the report & end the simulation
+ */
+static inline void bench_done(void)
+{
+	bench_mark = BENCH_DONE;
+}
+
+void bench_suite(void);
+
+#endif
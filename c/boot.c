@@ -0,0 +1,298 @@
+/*
+ * boot.c - serial bootloader for SPRAM images
+ * 10-17-26 E. Brombaugh
+ *
+ * Built in place of main.c as the ROM image. After reset it waits briefly
+ * for a host on the serial port and, if none appears, copies the image
+ * saved in flash into SPRAM and runs it. A host can raise the baud rate,
+ * then stream the image as LZSS-packed blocks that are each checked and
+ * unpacked straight into SPRAM. Images are linked with lnk-ram.lds and
+ * start.S built with RAM_APP - the ROM IRQ vector hands off to theirs.
+ */
+
+#include "up5k_riscv.h"
+#include "acia.h"
+#include "spi.h"
+#include "flash.h"
+#include "clkcnt.h"
+#include "boot.h"
+
+/* inter-byte timeout once a frame has started */
+#define BOOT_TMO_CLKS (20*CLKCNT_MS)
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t size;
+	uint16_t crc;
+	uint16_t flags;
+	uint32_t reserved;
+} boot_hdr;
+
+/* frame buffer - cmd, len, payload & crc */
+static uint8_t boot_frm[3+BOOT_BLK_MAX+2];
+
+/* image being loaded */
+static boot_hdr boot_img;
+static uint32_t boot_off;
+static uint16_t boot_seq;
+
+/*
+ * CRC-16/CCITT, a nibble at a time to keep the table small
+ */
+static uint16_t boot_crc(uint16_t crc, const uint8_t *p, uint32_t len)
+{
+	static const uint16_t tab[16] =
+	{
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+		0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+	};
+	
+	while(len--)
+	{
+		crc = (crc<<4) ^ tab[(crc>>12) ^ (*p>>4)];
+		crc = (crc<<4) ^ tab[(crc>>12) ^ (*p++ & 15)];
+	}
+	
+	return crc;
+}
+
+/*
+ * fill buf from the port, -1 if it goes quiet for tmo clocks
+ */
+static int boot_recv(uint8_t *buf, uint32_t len, uint32_t tmo)
+{
+	uint32_t n, t = clkcnt_deadline(tmo);
+	
+	while(len)
+	{
+		n = acia_read(buf, len);
+		if(n)
+		{
+			buf += n;
+			len -= n;
+			t = clkcnt_deadline(tmo);
+		}
+		else if(clkcnt_expired(t))
+			return -1;
+	}
+	
+	return 0;
+}
+
+/*
+ * unpack an LZSS block to dst, matches may reach back into earlier
+ * blocks. Returns -1 if it's malformed.
+ */
+static int boot_unpack(uint8_t *dst, uint32_t n, const uint8_t *src,
+	uint32_t slen)
+{
+	const uint8_t *send = src + slen;
+	uint8_t *end = dst + n, *m;
+	uint32_t flags = 0, off, len;
+	
+	while(dst < end)
+	{
+		if(flags < 0x100)
+		{
+			if(src >= send)
+				return -1;
+			flags = *src++ | 0xff00;
+		}
+		
+		if(flags & 1)
+		{
+			if(src >= send)
+				return -1;
+			*dst++ = *src++;
+		}
+		else
+		{
+			if(src + 2 > send)
+				return -1;
+			off = (src[0] | ((src[1] & 0xf0) << 4)) + 1;
+			len = (src[1] & 0x0f) + 3;
+			src += 2;
+			m = dst - off;
+			if((m < (uint8_t *)BOOT_APP_BASE) || (dst + len > end))
+				return -1;
+			while(len--)
+				*dst++ = *m++;
+		}
+		flags >>= 1;
+	}
+	
+	return (src == send) ? 0 : -1;
+}
+
+/*
+ * little-endian fields from a payload
+ */
+static uint32_t boot_u16(const uint8_t *p)
+{
+	return p[0] | (p[1]<<8);
+}
+
+static uint32_t boot_u32(const uint8_t *p)
+{
+	return boot_u16(p) | (boot_u16(p+2)<<16);
+}
+
+/*
+ * write the loaded image to flash, header last so a torn save is ignored
+ */
+static int boot_save(void)
+{
+	uint8_t *img = (uint8_t *)BOOT_APP_BASE;
+	
+	flash_erase(SPI0, BOOT_FLASH, sizeof(boot_hdr) + boot_img.size);
+	flash_write(SPI0, img, BOOT_FLASH + sizeof(boot_hdr), boot_img.size);
+	if(flash_verify(SPI0, img, BOOT_FLASH + sizeof(boot_hdr), boot_img.size))
+		return -1;
+	flash_write(SPI0, (uint8_t *)&boot_img, BOOT_FLASH, sizeof(boot_hdr));
+	
+	return 0;
+}
+
+/*
+ * copy the flash image into SPRAM, -1 if there isn't a good one
+ */
+static int boot_flash(void)
+{
+	uint8_t *img = (uint8_t *)BOOT_APP_BASE;
+	
+	flash_read(SPI0, (uint8_t *)&boot_img, BOOT_FLASH, sizeof(boot_hdr));
+	if((boot_img.magic != BOOT_MAGIC) || !boot_img.size ||
+		(boot_img.size > BOOT_APP_MAX))
+		return -1;
+	
+	flash_read(SPI0, img, BOOT_FLASH + sizeof(boot_hdr), boot_img.size);
+	
+	return (boot_crc(0xffff, img, boot_img.size) == boot_img.crc) ? 0 : -1;
+}
+
+/*
+ * hand over to the image at the rate it expects
+ */
+static void boot_run(void)
+{
+	acia_set_baud(BOOT_BAUD);
+	((void (*)(void))BOOT_APP_BASE)();
+}
+
+/*
+ * act on a good frame, returns BOOT_ACK or BOOT_NAK
+ */
+static uint8_t boot_cmd(uint8_t cmd, uint8_t *p, uint32_t len)
+{
+	uint32_t baud, raw;
+	
+	switch(cmd)
+	{
+		case BOOT_SYNC:
+			return BOOT_ACK;
+		
+		case BOOT_RATE:
+			baud = boot_u32(p);
+			if((len != 4) || (baud < 16*CLKCNT_HZ/ACIA_DIV_MAX + 1) ||
+				(baud > 16*CLKCNT_HZ/ACIA_DIV_MIN))
+				return BOOT_NAK;
+			
+			/* switches once the ACK has gone */
+			acia_putc(BOOT_ACK);
+			acia_set_baud(baud);
+			return 0;
+		
+		case BOOT_HEAD:
+			boot_img.size = boot_u32(p);
+			if((len != 8) || !boot_img.size || (boot_img.size > BOOT_APP_MAX))
+				return BOOT_NAK;
+			boot_img.magic = BOOT_MAGIC;
+			boot_img.crc = boot_u16(p+4);
+			boot_img.flags = boot_u16(p+6);
+			boot_img.reserved = ~0;
+			boot_off = 0;
+			boot_seq = 0;
+			return BOOT_ACK;
+		
+		case BOOT_DATA:
+			if(len < 4)
+				return BOOT_NAK;
+			
+			/* a repeat of the last block means our ACK was lost */
+			if(boot_u16(p) == (uint16_t)(boot_seq - 1))
+				return BOOT_ACK;
+			raw = boot_u16(p+2);
+			if((boot_u16(p) != boot_seq) || (raw > BOOT_BLK_RAW) ||
+				(boot_off + raw > boot_img.size) ||
+				boot_unpack((uint8_t *)BOOT_APP_BASE + boot_off, raw, p+4, len-4))
+				return BOOT_NAK;
+			boot_off += raw;
+			boot_seq++;
+			return BOOT_ACK;
+		
+		case BOOT_GO:
+			if(!boot_img.size || (boot_off != boot_img.size) ||
+				(boot_crc(0xffff, (uint8_t *)BOOT_APP_BASE, boot_img.size) !=
+					boot_img.crc))
+				return BOOT_NAK;
+			if((boot_img.flags & BOOT_FL_SAVE) && boot_save())
+				return BOOT_NAK;
+			
+			acia_putc(BOOT_ACK);
+			boot_run();
+			return 0;
+	}
+	
+	return BOOT_NAK;
+}
+
+/*
+ * receive & answer one frame, -1 if nothing arrived in tmo clocks
+ */
+static int boot_frame(uint32_t tmo)
+{
+	uint32_t len, t;
+	uint8_t rsp;
+	
+	/* wait for a frame to start */
+	t = clkcnt_deadline(tmo);
+	while(!(acia_ctlstat & ACIA_ST_RXF))
+		if(clkcnt_expired(t))
+			return -1;
+	
+	if(boot_recv(boot_frm, 3, BOOT_TMO_CLKS))
+		return 0;
+	len = boot_u16(boot_frm+1);
+	if((len > BOOT_BLK_MAX) || boot_recv(boot_frm+3, len+2, BOOT_TMO_CLKS) ||
+		(boot_crc(0xffff, boot_frm, 3+len) != boot_u16(boot_frm+3+len)))
+	{
+		/* let the rest of a bad frame go by, then ask again */
+		while(!boot_recv(boot_frm, 1, 2*CLKCNT_MS));
+		acia_putc(BOOT_NAK);
+		return 0;
+	}
+	
+	rsp = boot_cmd(boot_frm[0], boot_frm+3, len);
+	if(rsp)
+		acia_putc(rsp);
+	
+	return 0;
+}
+
+/*
+ * loader entry
+ */
+void main()
+{
+	spi_init(SPI0);
+	flash_init(SPI0);
+	acia_puts("\n\rup5k_riscv boot\n\r");
+	
+	/* boot flash unless a host turns up */
+	if((boot_frame(BOOT_WAIT_MS*CLKCNT_MS) < 0) && !boot_flash())
+		boot_run();
+	
+	while(1)
+		boot_frame(CLKCNT_HZ);
+}
@@ -0,0 +1,48 @@
+/*
+ * boot.h - serial bootloader protocol & image layout
+ * 10-17-26 E. Brombaugh
+ *
+ * Keep in step with tools/boot_upload.py.
+ */
+
+#ifndef __boot__
+#define __boot__
+
+/* images run from the bottom of SPRAM, the loader lives in the top 4kB */
+#define BOOT_APP_BASE 0x10000000
+#define BOOT_APP_MAX 0xF000
+
+/* image saved in flash below the XIP code - header then raw image */
+#define BOOT_FLASH 0x0C0000
+#define BOOT_MAGIC 0x544F4F42	// "BOOT"
+
+/* rate the loader starts at and hands the image back at */
+#define BOOT_BAUD 115200
+
+/* ms to wait for a host before booting the flash image */
+#define BOOT_WAIT_MS 500
+
+/*
+ * frames are {cmd, len lo, len hi, payload[len], crc16 lo, crc16 hi} with
+ * CRC-16/CCITT over everything before the CRC. Each is answered with
+ * BOOT_ACK or BOOT_NAK.
+ */
+#define BOOT_SYNC 'S'		// no payload
+#define BOOT_RATE 'B'		// u32 baud, switches after the ACK
+#define BOOT_HEAD 'H'		// u32 size, u16 image crc, u16 flags
+#define BOOT_DATA 'D'		// u16 seq, u16 raw len, LZSS data
+#define BOOT_GO 'G'			// no payload, checks image & runs it
+#define BOOT_ACK 0x06
+#define BOOT_NAK 0x15
+
+#define BOOT_FL_SAVE 0x0001	// also save the image to flash
+
+/*
+ * data blocks unpack to at most BOOT_BLK_RAW bytes. LZSS groups start
+ * with a flag byte, LSB first, 1 for a literal and 0 for a 2-byte match
+ * of 3-18 bytes from 1-4096 back: {off[7:0]}, {off[11:8], len-3}.
+ */
+#define BOOT_BLK_RAW 1024
+#define BOOT_BLK_MAX (4+BOOT_BLK_RAW+BOOT_BLK_RAW/8+1)
+
+#endif
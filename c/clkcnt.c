@@ -1,26 +1,85 @@
 /*
- * clkcnt.h - clock cycle counter driver
+ * clkcnt.c - clock cycle counter driver
  * 07-03-19 E. Brombaugh
  */
 
 #include "clkcnt.h"
+#include "irq.h"
+
+/* compare channel state */
+static clkcnt_fn clkcnt_fns[CLKCNT_TIMERS];
+static uint32_t clkcnt_period[CLKCNT_TIMERS];
+static uint8_t clkcnt_used;
 
 /*
- * delay for clocks
+ * timer compare IRQ - rearm periodic channels, then call back
  */
-void clkcnt_wait(uint32_t clks)
+static void clkcnt_isr(void)
 {
-	clkcnt_reg = 0;
+	uint32_t pend = TIMER->PEND & TIMER->IE;
+	uint8_t i;
+	clkcnt_fn fn;
 	
-	while(clkcnt_reg < clks);
+	for(i=0;i<CLKCNT_TIMERS;i++)
+	{
+		if(pend & (1<<i))
+		{
+			TIMER->PEND = 1<<i;
+			fn = clkcnt_fns[i];
+			
+			if(clkcnt_period[i])
+			{
+				/* advance from the last compare so there's no drift */
+				TIMER->CMP[i] += clkcnt_period[i];
+				TIMER->ARM = 1<<i;
+			}
+			else
+			{
+				TIMER->IE &= ~(1<<i);
+				clkcnt_used &= ~(1<<i);
+			}
+			
+			if(fn)
+				fn();
+		}
+	}
 }
 
 /*
- * delay for exactly 1 millisecond
+ * hook up the compare interrupt
  */
-void clkcnt_1ms(void)
+void clkcnt_init(void)
 {
-	clkcnt_wait(24000);
+	TIMER->DISARM = ~0;
+	TIMER->IE = 0;
+	TIMER->PEND = ~0;
+	clkcnt_used = 0;
+	irq_register(IRQ_TIMER, clkcnt_isr);
+}
+
+/*
+ * full 64-bit cycle count. Reading CNTLO latches CNTHI, so IRQs are held
+ * off between the two or an ISR's clkcnt_get() would re-latch it.
+ */
+uint64_t clkcnt_get64(void)
+{
+	uint32_t mask = irq_save(), lo, hi;
+	
+	lo = TIMER->CNTLO;
+	hi = TIMER->CNTHI;
+	irq_restore(mask);
+	
+	return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * delay for clocks without disturbing the counter
+ */
+void clkcnt_wait(uint32_t clks)
+{
+	uint32_t end = clkcnt_deadline(clks);
+	
+	while(!clkcnt_expired(end));
 }
 
 /*
@@ -28,6 +87,60 @@ void clkcnt_1ms(void)
  */
 void clkcnt_delayms(uint32_t ms)
 {
+	uint32_t end = clkcnt_get();
+	
 	while(ms--)
-		clkcnt_1ms();
+	{
+		end += CLKCNT_MS;
+		while(!clkcnt_expired(end));
+	}
+}
+
+/*
+ * call fn from IRQ after clks, then every period clks if period is
+ * non-zero. Returns timer number or -1 if none are free.
+ */
+int clkcnt_timer_start(uint32_t clks, uint32_t period, clkcnt_fn fn)
+{
+	uint32_t mask = irq_save();
+	int t;
+	
+	for(t=0;t<CLKCNT_TIMERS;t++)
+		if(!(clkcnt_used & (1<<t)))
+			break;
+	
+	if(t<CLKCNT_TIMERS)
+	{
+		clkcnt_used |= 1<<t;
+		clkcnt_fns[t] = fn;
+		clkcnt_period[t] = period;
+		TIMER->CMP[t] = clkcnt_deadline(clks);
+		TIMER->PEND = 1<<t;
+		TIMER->IE |= 1<<t;
+		TIMER->ARM = 1<<t;
+	}
+	else
+		t = -1;
+	
+	irq_restore(mask);
+	
+	return t;
+}
+
+/*
+ * cancel a timer
+ */
+void clkcnt_timer_stop(int t)
+{
+	uint32_t mask;
+	
+	if((t<0) || (t>=CLKCNT_TIMERS))
+		return;
+	
+	mask = irq_save();
+	TIMER->DISARM = 1<<t;
+	TIMER->IE &= ~(1<<t);
+	TIMER->PEND = 1<<t;
+	clkcnt_used &= ~(1<<t);
+	irq_restore(mask);
 }
@@ -8,8 +8,50 @@
 
 #include "up5k_riscv.h"
 
+#define CLKCNT_HZ 24000000
+#define CLKCNT_MS (CLKCNT_HZ/1000)
+#define CLKCNT_US (CLKCNT_HZ/1000000)
+#define CLKCNT_TIMERS 4
+
+typedef void (*clkcnt_fn)(void);
+
+/*
+ * low 32 bits of the cycle counter - wraps every ~179 seconds
+ */
+static inline uint32_t clkcnt_get(void)
+{
+	return TIMER->CNTLO;
+}
+
+/*
+ * deadline clks from now, valid up to 2^31 clocks ahead
+ */
+static inline uint32_t clkcnt_deadline(uint32_t clks)
+{
+	return clkcnt_get() + clks;
+}
+
+/*
+ * has a deadline passed?
+ */
+static inline int clkcnt_expired(uint32_t deadline)
+{
+	return (int32_t)(clkcnt_get() - deadline) >= 0;
+}
+
+/*
+ * clocks since a timestamp
+ */
+static inline uint32_t clkcnt_elapsed(uint32_t start)
+{
+	return clkcnt_get() - start;
+}
+
+void clkcnt_init(void);
+uint64_t clkcnt_get64(void);
 void clkcnt_wait(uint32_t clks);
 void clkcnt_delayms(uint32_t ms);
+int clkcnt_timer_start(uint32_t clks, uint32_t period, clkcnt_fn fn);
+void clkcnt_timer_stop(int t);
 
 #endif
-
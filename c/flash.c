@@ -5,10 +5,14 @@
 
 #include "flash.h"
 #include "spi.h"
+#include "clkcnt.h"
 
 /* flash commands */
 #define FLASH_WRPG 0x02 // write page
 #define FLASH_READ 0x03 // read data
+#define FLASH_FRD  0x0B // fast read
+#define FLASH_DRD  0x3B // dual output fast read
+#define FLASH_SFDP 0x5A // read SFDP
 #define FLASH_RSR1 0x05 // read status reg 1
 #define FLASH_RSR2 0x35 // read status reg 2
 #define FLASH_RSR3 0x15 // read status reg 3
@@ -16,20 +20,99 @@
 #define FLASH_WSR2 0x31 // write status reg 2
 #define FLASH_WSR3 0x11 // write status reg 3
 #define FLASH_WEN  0x06 // write enable
+#define FLASH_SE4  0x20 // erase sector 4k
 #define FLASH_EB32 0x52 // erase block 32k
+#define FLASH_EB64 0xD8 // erase block 64k
 #define FLASH_GBUL 0x98 // global unlock
 #define FLASH_WKUP 0xAB // wakeup
 #define FLASH_ERST 0x66 // enable reset
 #define FLASH_RST  0x99 // reset
 #define FLASH_ID   0x9f // get ID bytes
 
+/* status reg 1 bits */
+#define FLASH_SR_BUSY 0x01
+#define FLASH_SR_WEL  0x02
+
+/* SFDP signature & basic parameter table fields */
+#define SFDP_SIG   0x50444653	// "SFDP"
+#define SFDP_112   (1<<16)		// 1-1-2 fast read supported
+#define SFDP_114   (1<<22)		// 1-1-4 fast read supported
+
+/* flash is on CS0 at the spi_init() clock, reselected if the core has
+   been switched to another device since */
+static spi_dev flash_dev[2];
+
+/*
+ * select the flash - a stream read left open by flash_stream() holds CS
+ * low from the fabric reader, so end it first or CS never rises between
+ * its read and this command
+ */
+static void flash_cs_low(SPI_TypeDef *s)
+{
+#ifndef BOOT
+	if((s == SPI0) && (xip_ctrl & XIP_STAT_OPEN))
+	{
+		xip_ctrl = XIP_CTRL_CLOSE;
+		while(xip_ctrl & XIP_STAT_OPEN);
+	}
+#endif
+	
+	spi_dev_select(&flash_dev[s == SPI1]);
+}
+
+#ifndef BOOT
+/* fabric reader command, 0 = read through SB_SPI0. The bootloader only
+   reads through SB_SPI0 and leaves out the reader, cache and SFDP code to
+   fit the ROM */
+static uint32_t flash_mode;
+
+/* optional block cache in front of flash_read on SPI0 */
+static struct
+{
+	uint32_t *tag;			// flash line number per slot, ~0 if empty
+	uint8_t *data;			// lines, slot order
+	uint32_t shift;			// log2 of line size
+	uint32_t lines;			// slots, a power of 2
+	uint32_t last;			// last line fetched, for prefetch
+	flash_cache_info st;
+} flash_cache;
+#endif
+
+/*
+ * send a single byte command
+ */
+static void flash_cmd(SPI_TypeDef *s, uint8_t cmd)
+{
+	flash_cs_low(s);
+	
+	/* check for tx ready */
+	spi_tx_wait(s);
+	
+	/* send command */
+	s->SPITXDR = cmd;
+	
+	/* wait for rx ready (transmission complete) */
+	spi_rx_wait(s);
+	
+	spi_cs_high(s);
+}
 
 /*
- * wake up SPI Flash
+ * wake up SPI Flash and pick the fastest read it and the XIP reader share
  */
 void flash_init(SPI_TypeDef *s)
 {
-	spi_tx_byte(s, FLASH_WKUP);
+	spi_dev_init(&flash_dev[s == SPI1], s, 0, 0x02, SPI_MODE0);
+	flash_cmd(s, FLASH_WKUP);
+	
+	/* tRES1 before the next command */
+	clkcnt_wait(3*CLKCNT_US);
+	
+#ifndef BOOT
+	flash_mode = 0;
+	if(s == SPI0)
+		flash_setmode(flash_detect(s));
+#endif
 }
 
 /*
@@ -49,14 +132,84 @@ void flash_header(SPI_TypeDef *s, uint8_t cmd, uint32_t addr)
 	spi_transmit(s, txdat, 4);
 }
 
+#ifndef BOOT
 /*
- * read bytes from SPI Flash
+ * copy from the XIP stream window - the reader keeps the command open
+ * and prefetches so sequential words only cost their data clocks
  */
-void flash_read(SPI_TypeDef *s, uint8_t *dst, uint32_t addr, uint32_t len)
+static void flash_stream(uint8_t *dst, uint32_t addr, uint32_t len)
+{
+	volatile uint32_t *src = (volatile uint32_t *)(XIP_STREAM + (addr&~3));
+	uint32_t *wdst, w;
+	
+	/* leading bytes to a word boundary in flash */
+	if(addr&3)
+	{
+		w = *src++ >> (8*(addr&3));
+		while((addr&3) && len)
+		{
+			*dst++ = w;
+			w >>= 8;
+			addr++;
+			len--;
+		}
+	}
+	
+	/* whole words */
+	if(((uint32_t)dst&3) == 0)
+	{
+		wdst = (uint32_t *)dst;
+		while(len >= 4)
+		{
+			*wdst++ = *src++;
+			len -= 4;
+		}
+		dst = (uint8_t *)wdst;
+	}
+	else
+	{
+		while(len >= 4)
+		{
+			w = *src++;
+			dst[0] = w;
+			dst[1] = w>>8;
+			dst[2] = w>>16;
+			dst[3] = w>>24;
+			dst += 4;
+			len -= 4;
+		}
+	}
+	
+	/* trailing bytes */
+	if(len)
+	{
+		w = *src;
+		while(len--)
+		{
+			*dst++ = w;
+			w >>= 8;
+		}
+	}
+}
+#endif
+
+/*
+ * read bytes from SPI Flash, uncached
+ */
+static void flash_fetch(SPI_TypeDef *s, uint8_t *dst, uint32_t addr, uint32_t len)
 {
 	uint8_t dummy __attribute ((unused));
 	
-	spi_cs_low(s);
+#ifndef BOOT
+	/* SPI0 flash goes through the fabric reader once a mode is set */
+	if((s == SPI0) && flash_mode)
+	{
+		flash_stream(dst, addr, len);
+		return;
+	}
+#endif
+	
+	flash_cs_low(s);
 	
 	/* send read header */
 	flash_header(s, FLASH_READ, addr);
@@ -69,19 +222,227 @@ void flash_read(SPI_TypeDef *s, uint8_t *dst, uint32_t addr, uint32_t len)
 	dummy = s->SPIRXDR;
 	
 	/* get the buffer */
+	spi_dma_receive(s, dst, len);
+	
+	spi_cs_high(s);
+}
+
+#ifndef BOOT
+/*
+ * set up the read cache in a buffer of size bytes, which must be in SPRAM
+ * for DMA. line is the bytes per line, a power of 2. NULL buf disables it.
+ */
+void flash_cache_init(uint8_t *buf, uint32_t size, uint32_t line)
+{
+	uint32_t n;
+	
+	flash_cache.lines = 0;
+	if(!buf || !line)
+		return;
+	
+	/* tags first, then as many lines as fit rounded down to a power of 2 */
+	flash_cache.tag = (uint32_t *)(((uint32_t)buf + 3) & ~3);
+	size -= (uint8_t *)flash_cache.tag - buf;
+	for(flash_cache.shift=0;(1<<flash_cache.shift)<line;flash_cache.shift++);
+	line = 1<<flash_cache.shift;
+	n = size / (line + 4);
+	if(!n)
+		return;
+	while(n & (n-1))
+		n &= n-1;
+	flash_cache.data = (uint8_t *)(flash_cache.tag + n);
+	flash_cache.lines = n;
+	
+	flash_cache_flush();
+	flash_cache_stats(0);
+}
+
+/*
+ * invalidate the read cache
+ */
+void flash_cache_flush(void)
+{
+	uint32_t i;
+	
+	for(i=0;i<flash_cache.lines;i++)
+		flash_cache.tag[i] = ~0;
+	flash_cache.last = ~0;
+}
+
+/*
+ * get read cache statistics & clear them. NULL just clears.
+ */
+void flash_cache_stats(flash_cache_info *info)
+{
+	if(info)
+		*info = flash_cache.st;
+	flash_cache.st.hits = 0;
+	flash_cache.st.misses = 0;
+	flash_cache.st.prefetches = 0;
+	flash_cache.st.bypasses = 0;
+}
+#endif
+
+/*
+ * read bytes from SPI Flash. With the cache on, reads are served from
+ * whole lines and a miss on the line after the last one fetched brings
+ * in the following line with it. Reads of a quarter of the cache or
+ * more go straight to the flash so big blits don't evict everything.
+ */
+void flash_read(SPI_TypeDef *s, uint8_t *dst, uint32_t addr, uint32_t len)
+{
+#ifdef BOOT
+	flash_fetch(s, dst, addr, len);
+#else
+	uint32_t ln, slot, off, sz, n, line;
+	uint8_t *src;
+	
+	if((s != SPI0) || !flash_cache.lines ||
+		(len >= (flash_cache.lines << flash_cache.shift) / 4))
+	{
+		if(flash_cache.lines)
+			flash_cache.st.bypasses++;
+		flash_fetch(s, dst, addr, len);
+		return;
+	}
+	
+	line = 1 << flash_cache.shift;
+	while(len)
+	{
+		ln = addr >> flash_cache.shift;
+		slot = ln & (flash_cache.lines - 1);
+		if(flash_cache.tag[slot] != ln)
+		{
+			/* sequential misses fetch two lines with one header */
+			n = 1;
+			if((ln == flash_cache.last + 1) && (slot + 1 < flash_cache.lines))
+			{
+				n = 2;
+				flash_cache.tag[slot + 1] = ln + 1;
+				flash_cache.st.prefetches++;
+			}
+			flash_fetch(s, flash_cache.data + (slot << flash_cache.shift),
+				ln << flash_cache.shift, n << flash_cache.shift);
+			flash_cache.tag[slot] = ln;
+			flash_cache.last = ln + n - 1;
+			flash_cache.st.misses++;
+		}
+		else
+			flash_cache.st.hits++;
+		
+		/* copy what's wanted from this line */
+		off = addr & (line - 1);
+		sz = line - off;
+		if(sz > len)
+			sz = len;
+		src = flash_cache.data + (slot << flash_cache.shift) + off;
+		addr += sz;
+		len -= sz;
+		while(sz--)
+			*dst++ = *src++;
+	}
+#endif
+}
+
+#ifndef BOOT
+/*
+ * read bytes from the SFDP table
+ */
+void flash_sfdp(SPI_TypeDef *s, uint8_t *dst, uint32_t addr, uint32_t len)
+{
+	uint8_t dummy __attribute ((unused));
+	
+	flash_cs_low(s);
+	
+	/* send SFDP header */
+	flash_header(s, FLASH_SFDP, addr);
+	
+	/* wait for tx ready */
+	spi_tx_wait(s);
+	
+	/* dummy reads */
+	dummy = s->SPIRXDR;
+	dummy = s->SPIRXDR;
+	
+	/* dummy byte, then the table */
+	spi_receive(s, dst, 1);
 	spi_receive(s, dst, len);
 	
 	spi_cs_high(s);
 }
 
 /*
- * read bytes from SPI Flash
+ * choose a fabric reader command from SFDP, or from the JEDEC ID if the
+ * part has no SFDP table. Returns 0 if the flash doesn't answer.
+ */
+uint32_t flash_detect(SPI_TypeDef *s)
+{
+	uint32_t hdr[4], bfpt[4], id, dw;
+	
+	id = flash_id(s);
+	if((id == 0) || (id == 0xffffff))
+		return 0;
+	
+	/* fast read works on nearly everything */
+	dw = XIP_MODE(FLASH_FRD, 8, 0);
+	
+	flash_sfdp(s, (uint8_t *)hdr, 0, 16);
+	if((hdr[0] == SFDP_SIG) && ((hdr[2]&0xff) == 0))
+	{
+		/* first parameter header is the basic flash parameter table */
+		flash_sfdp(s, (uint8_t *)bfpt, hdr[3]&0xffffff, 16);
+		
+		if((bfpt[0] & SFDP_114) && (xip_ctrl & XIP_STAT_QUAD))
+		{
+			/* 1-1-4 in dword 3 [31:16]: opcode, mode clocks, dummy */
+			id = ((bfpt[2]>>16)&0x1f) + ((bfpt[2]>>21)&0x7);
+			if(id < 16)
+				return XIP_MODE(bfpt[2]>>24, id, 2);
+		}
+		
+		if(bfpt[0] & SFDP_112)
+		{
+			/* 1-1-2 in dword 4 [15:0] */
+			id = (bfpt[3]&0x1f) + ((bfpt[3]>>5)&0x7);
+			if(id < 16)
+				return XIP_MODE((bfpt[3]>>8)&0xff, id, 1);
+		}
+	}
+	else if(((id>>16) == 0xEF) || ((id>>16) == 0xC8) || ((id>>16) == 0xC2))
+	{
+		/* Winbond, GigaDevice & Macronix parts all do dual output */
+		dw = XIP_MODE(FLASH_DRD, 8, 1);
+	}
+	
+	return dw;
+}
+
+/*
+ * set the fabric reader command, 0 reads through SB_SPI0
+ */
+void flash_setmode(uint32_t mode)
+{
+	flash_mode = mode;
+	xip_mode = mode ? mode : XIP_MODE(FLASH_READ, 0, 0);
+}
+
+/*
+ * get the fabric reader command
+ */
+uint32_t flash_getmode(void)
+{
+	return flash_mode;
+}
+#endif
+
+/*
+ * read a status register from SPI Flash
  */
 uint8_t flash_rdreg(SPI_TypeDef *s, uint8_t cmd)
 {
 	uint8_t result;
 	
-	spi_cs_low(s);
+	flash_cs_low(s);
 	
 	/* wait for tx ready */
 	spi_tx_wait(s);
@@ -118,49 +479,173 @@ uint8_t flash_status(SPI_TypeDef *s)
 }
 
 /*
- * wait for SPI Flash not busy
+ * wait for SPI Flash not busy. Status 1 repeats for as long as CS is held
+ * so each poll after the first costs one byte instead of a command.
  */
 void flash_busy_wait(SPI_TypeDef *s)
 {
-	while(!(flash_status(s)&1));
+	uint8_t sr;
+	
+	flash_cs_low(s);
+	
+	/* send command */
+	spi_tx_wait(s);
+	s->SPITXDR = FLASH_RSR1;
+	spi_rx_wait(s);
+	sr = s->SPIRXDR;	// dummy read
+	
+	/* poll */
+	do
+		spi_receive(s, &sr, 1);
+	while(sr & FLASH_SR_BUSY);
+	
+	spi_cs_high(s);
+}
+
+/*
+ * drop anything the XIP reader or read cache holds from before a program
+ * or erase
+ */
+static void flash_xip_flush(SPI_TypeDef *s)
+{
+	if(s == SPI0)
+	{
+		xip_ctrl = XIP_CTRL_FLUSH;
+#ifndef BOOT
+		flash_cache_flush();
+#endif
+	}
 }
 
 /*
- * erase 32kB block in SPI Flash
+ * send one erase command and wait for it to finish
  */
-void flash_eraseblk(SPI_TypeDef *s, uint32_t addr)
+static void flash_erase_cmd(SPI_TypeDef *s, uint8_t cmd, uint32_t addr)
 {
 	/* write enable */
-	spi_tx_byte(s, FLASH_WEN);
+	flash_cmd(s, FLASH_WEN);
 	
-	spi_cs_low(s);
+	flash_cs_low(s);
 	
-	/* send read header */
-	flash_header(s, FLASH_EB32, addr);
-	
-	/* wait for rx ready */
-	spi_rx_wait(s);
+	/* send erase header */
+	flash_header(s, cmd, addr);
+	spi_idle_wait(s);
 	
 	spi_cs_high(s);
+	
+	flash_busy_wait(s);
+}
+
+/*
+ * erase 32kB block in SPI Flash
+ */
+void flash_eraseblk(SPI_TypeDef *s, uint32_t addr)
+{
+	flash_erase_cmd(s, FLASH_EB32, addr);
+	flash_xip_flush(s);
+}
+
+/*
+ * erase the 4kB sectors covering addr to addr+len-1, using 64kB and
+ * 32kB block erases where they fit since those take far less time per
+ * byte than sector erases
+ */
+void flash_erase(SPI_TypeDef *s, uint32_t addr, uint32_t len)
+{
+	uint32_t end = (addr + len + FLASH_SECTOR - 1) & ~(FLASH_SECTOR - 1);
+	
+	addr &= ~(FLASH_SECTOR - 1);
+	while(addr < end)
+	{
+		if(!(addr & 0xffff) && (end - addr) >= 0x10000)
+		{
+			flash_erase_cmd(s, FLASH_EB64, addr);
+			addr += 0x10000;
+		}
+		else if(!(addr & 0x7fff) && (end - addr) >= 0x8000)
+		{
+			flash_erase_cmd(s, FLASH_EB32, addr);
+			addr += 0x8000;
+		}
+		else
+		{
+			flash_erase_cmd(s, FLASH_SE4, addr);
+			addr += FLASH_SECTOR;
+		}
+	}
+	
+	flash_xip_flush(s);
 }
 
 /*
- * write bytes to SPI Flash
+ * write bytes to SPI Flash. Any length and alignment - programs are split
+ * at page boundaries since the flash wraps within a page.
  */
 void flash_write(SPI_TypeDef *s, uint8_t *src, uint32_t addr, uint32_t len)
 {
-	/* write enable */
-	spi_tx_byte(s, FLASH_WEN);
+	uint32_t sz;
 	
-	spi_cs_low(s);
+	while(len)
+	{
+		sz = FLASH_PAGE - (addr & (FLASH_PAGE - 1));
+		if(sz > len)
+			sz = len;
+		
+		/* write enable */
+		flash_cmd(s, FLASH_WEN);
+		
+		flash_cs_low(s);
+		
+		/* send program header */
+		flash_header(s, FLASH_WRPG, addr);
+		
+		/* send data packet */
+		spi_dma_transmit(s, src, sz);
+		spi_idle_wait(s);
+		
+		spi_cs_high(s);
+		
+		flash_busy_wait(s);
+		
+		src += sz;
+		addr += sz;
+		len -= sz;
+	}
 	
-	/* send read header */
-	flash_header(s, FLASH_WRPG, addr);
+	flash_xip_flush(s);
+}
+
+/*
+ * compare SPI Flash against a buffer, returns 0 if they match
+ */
+int flash_verify(SPI_TypeDef *s, uint8_t *src, uint32_t addr, uint32_t len)
+{
+	uint8_t buf[64];
+	uint32_t i, sz;
 	
-	/* send data packet */
-	spi_transmit(s, src, len);
+	while(len)
+	{
+		sz = len > sizeof(buf) ? sizeof(buf) : len;
+		flash_read(s, buf, addr, sz);
+		for(i=0;i<sz;i++)
+			if(buf[i] != *src++)
+				return -1;
+		addr += sz;
+		len -= sz;
+	}
 	
-	spi_cs_high(s);
+	return 0;
+}
+
+/*
+ * erase, write and verify. The erase covers whole 4kB sectors so anything
+ * else sharing them is lost.
+ */
+int flash_program(SPI_TypeDef *s, uint8_t *src, uint32_t addr, uint32_t len)
+{
+	flash_erase(s, addr, len);
+	flash_write(s, src, addr, len);
+	return flash_verify(s, src, addr, len);
 }
 
 /*
@@ -170,7 +655,7 @@ uint32_t flash_id(SPI_TypeDef *s)
 {
 	uint8_t result[3];
 	
-	spi_cs_low(s);
+	flash_cs_low(s);
 	
 	/* send command */
 	spi_tx_wait(s);
@@ -8,13 +8,34 @@
 
 #include "up5k_riscv.h"
 
+#define FLASH_PAGE 256
+#define FLASH_SECTOR 4096
+
+typedef struct
+{
+	uint32_t hits;			// line lookups served from the cache
+	uint32_t misses;		// line fetches
+	uint32_t prefetches;	// extra lines fetched on sequential misses
+	uint32_t bypasses;		// reads too big to cache
+} flash_cache_info;
+
 void flash_init(SPI_TypeDef *s);
 void flash_read(SPI_TypeDef *s, uint8_t *dst, uint32_t addr, uint32_t len);
+void flash_cache_init(uint8_t *buf, uint32_t size, uint32_t line);
+void flash_cache_flush(void);
+void flash_cache_stats(flash_cache_info *info);
+void flash_sfdp(SPI_TypeDef *s, uint8_t *dst, uint32_t addr, uint32_t len);
+uint32_t flash_detect(SPI_TypeDef *s);
+void flash_setmode(uint32_t mode);
+uint32_t flash_getmode(void);
 uint8_t flash_rdreg(SPI_TypeDef *s, uint8_t cmd);
 uint8_t flash_status(SPI_TypeDef *s);
 void flash_busy_wait(SPI_TypeDef *s);
 void flash_eraseblk(SPI_TypeDef *s, uint32_t addr);
+void flash_erase(SPI_TypeDef *s, uint32_t addr, uint32_t len);
 void flash_write(SPI_TypeDef *s, uint8_t *src, uint32_t addr, uint32_t len);
+int flash_verify(SPI_TypeDef *s, uint8_t *src, uint32_t addr, uint32_t len);
+int flash_program(SPI_TypeDef *s, uint8_t *src, uint32_t addr, uint32_t len);
 uint32_t flash_id(SPI_TypeDef *s);
 
 #endif
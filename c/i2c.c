@@ -1,12 +1,19 @@
 /*
  * i2c.c - i2c port driver
  * 06-23-20 E. Brombaugh
+ *
+ * Transactions are queued per port and run from the I2C interrupt so the
+ * CPU only spends a few register accesses per byte. Each one is a write
+ * phase, a read phase, or a write then a repeated start and a read. The
+ * core raises TRRDY when it can take the next command and the ISR steps
+ * the transaction along from that. The core has no interrupt for the bus
+ * going idle, so after a stop a one-shot clkcnt timer checks BUSY and
+ * starts the next transaction once it clears.
  */
 
-#include <stdio.h>
-#include "printf.h"
 #include "clkcnt.h"
 #include "i2c.h"
+#include "irq.h"
 #include "up5k_riscv.h"
 
 /* contro reg bits */
@@ -28,109 +35,359 @@
 #define I2C_SR_TROE 0x02
 #define I2C_SR_HGC 0x01
 
+#define I2C_IRQ_ARBL 0x08
+#define I2C_IRQ_TRRDY 0x04
+#define I2C_IRQ_TROE 0x02
+#define I2C_IRQ_HGC 0x01
+
+/* longest a stop condition takes to clear BUSY at 100kHz, and how often
+   to look */
+#define I2C_STOP_CLKS (50*CLKCNT_US)
+#define I2C_STOP_POLL_CLKS (10*CLKCNT_US)
+
+/* per-byte allowance before i2c_wait() gives up */
+#define I2C_BYTE_CLKS (CLKCNT_MS)
+
+/* transaction phases */
+enum i2c_phase
+{
+	I2C_PH_WR,		// address or data byte of the write phase sent
+	I2C_PH_RDA,		// read address sent
+	I2C_PH_RD,		// receiving
+};
+
+typedef struct
+{
+	I2C_TypeDef *s;
+	i2c_xfer *head, *tail;	// head is the transaction on the bus
+	uint8_t phase;
+	uint8_t idx;			// bytes done in this phase
+	uint8_t stopping;		// stop sent, bus not yet idle
+	uint32_t stop_end;		// when to stop waiting for idle
+} i2c_port;
+
+static i2c_port i2c_ports[2];
+
 /* some common operation macros */
-#define i2c_trrdy_wait(s) while(!(((s)->I2CSR)&I2C_SR_TRRDY))
+#define i2c_cmd(s, c) ((s)->I2CCMDR = (c) | I2C_CMD_CKSDIS)
+#define i2c_port_of(s) (&i2c_ports[(s) == I2C1])
+
+/*
+ * put the first queued transaction on the bus
+ */
+static void i2c_start(i2c_port *p)
+{
+	I2C_TypeDef *s = p->s;
+	i2c_xfer *x = p->head;
+	
+	if(!x)
+	{
+		s->I2CIRQEN = 0;
+		return;
+	}
+	
+	/* diagnostic flag for I2C activity */
+	gp_out |= 1;
+	
+	p->idx = 0;
+	if(x->wlen)
+	{
+		p->phase = I2C_PH_WR;
+		s->I2CTXDR = x->addr<<1;
+	}
+	else
+	{
+		p->phase = I2C_PH_RDA;
+		s->I2CTXDR = (x->addr<<1) | 1;
+	}
+	s->I2CIRQ = 0xff;
+	s->I2CIRQEN = I2C_IRQ_TRRDY | I2C_IRQ_ARBL;
+	i2c_cmd(s, I2C_CMD_STA | I2C_CMD_WR);
+}
+
+static void i2c0_stop_tick(void);
+static void i2c1_stop_tick(void);
+
+/*
+ * start the next transaction once the stop has cleared BUSY, looking
+ * again from a timer tick until it has or I2C_STOP_CLKS is up
+ */
+static void i2c_stop_poll(i2c_port *p)
+{
+	I2C_TypeDef *s = p->s;
+	
+	if((s->I2CSR & I2C_SR_BUSY) && !clkcnt_expired(p->stop_end))
+	{
+		if(clkcnt_timer_start(I2C_STOP_POLL_CLKS, 0,
+			(p == &i2c_ports[1]) ? i2c1_stop_tick : i2c0_stop_tick) >= 0)
+			return;
+		
+		/* no timer free - wait it out here */
+		while((s->I2CSR & I2C_SR_BUSY) && !clkcnt_expired(p->stop_end));
+	}
+	
+	p->stopping = 0;
+	i2c_start(p);
+}
+
+/*
+ * I2C0 stop poll tick
+ */
+static void i2c0_stop_tick(void)
+{
+	i2c_stop_poll(&i2c_ports[0]);
+}
+
+/*
+ * I2C1 stop poll tick
+ */
+static void i2c1_stop_tick(void)
+{
+	i2c_stop_poll(&i2c_ports[1]);
+}
+
+/*
+ * retire the transaction on the bus and start the next, after the stop
+ * has gone out
+ */
+static void i2c_finish(i2c_port *p, int8_t status)
+{
+	I2C_TypeDef *s = p->s;
+	i2c_xfer *x = p->head;
+	uint8_t ticking = p->stopping;
+	
+	if(status != I2C_ERR)
+	{
+		s->I2CIRQEN = 0;
+		i2c_cmd(s, I2C_CMD_STO);
+		p->stop_end = clkcnt_deadline(I2C_STOP_CLKS);
+		p->stopping = 1;
+	}
+	
+	gp_out &= ~1;
+	p->head = x->next;
+	if(!p->head)
+		p->tail = 0;
+	x->status = status;
+	if(x->done)
+		x->done(x);
+	
+	/* a tick already waiting on the bus will start the next one */
+	if(ticking)
+		return;
+	
+	if(p->stopping)
+		i2c_stop_poll(p);
+	else
+		i2c_start(p);
+}
+
+/*
+ * step a port's transaction on TRRDY or arbitration loss
+ */
+static void i2c_service(i2c_port *p)
+{
+	I2C_TypeDef *s = p->s;
+	i2c_xfer *x = p->head;
+	uint8_t irq = s->I2CIRQ, stat = s->I2CSR;
+	
+	s->I2CIRQ = irq;
+	if(!x)
+	{
+		s->I2CIRQEN = 0;
+		return;
+	}
+	
+	/* lost the bus - reset the core, nothing to stop */
+	if(stat & I2C_SR_ARBL)
+	{
+		s->I2CBRMSB = 0;
+		i2c_finish(p, I2C_ERR);
+		return;
+	}
+	
+	if(!(stat & I2C_SR_TRRDY))
+		return;
+	
+	switch(p->phase)
+	{
+		case I2C_PH_WR:
+			if(stat & I2C_SR_RARC)
+				i2c_finish(p, I2C_NACK);
+			else if(p->idx < x->wlen)
+			{
+				s->I2CTXDR = x->wbuf[p->idx++];
+				i2c_cmd(s, I2C_CMD_WR);
+			}
+			else if(x->rlen)
+			{
+				/* repeated start for the read */
+				p->phase = I2C_PH_RDA;
+				p->idx = 0;
+				s->I2CTXDR = (x->addr<<1) | 1;
+				i2c_cmd(s, I2C_CMD_STA | I2C_CMD_WR);
+			}
+			else
+				i2c_finish(p, I2C_OK);
+			break;
+		
+		case I2C_PH_RDA:
+			if(stat & I2C_SR_RARC)
+				i2c_finish(p, I2C_NACK);
+			else
+			{
+				/* ACK means NACK the next byte, so set it for the last */
+				p->phase = I2C_PH_RD;
+				i2c_cmd(s, I2C_CMD_RD | ((x->rlen == 1) ? I2C_CMD_ACK : 0));
+			}
+			break;
+		
+		case I2C_PH_RD:
+			x->rbuf[p->idx++] = s->I2CRXDR;
+			if(p->idx == x->rlen)
+				i2c_finish(p, I2C_OK);
+			else if(p->idx == x->rlen - 1)
+				i2c_cmd(s, I2C_CMD_RD | I2C_CMD_ACK);
+			break;
+	}
+}
+
+/*
+ * I2C0 interrupt
+ */
+static void i2c0_isr(void)
+{
+	i2c_service(&i2c_ports[0]);
+}
+
+/*
+ * I2C1 interrupt
+ */
+static void i2c1_isr(void)
+{
+	i2c_service(&i2c_ports[1]);
+}
 
 /*
  * initialize i2c port
  */
 void i2c_init(I2C_TypeDef *s)
 {
-#if 1
+	i2c_port *p = i2c_port_of(s);
+	
+	p->s = s;
+	p->head = p->tail = 0;
+	p->stopping = 0;
 	
+	s->I2CIRQEN = 0;
 	s->I2CCR1 = I2C_CCR_EN | 12;	// enable I2C
 	s->I2CBRMSB = 0;		// high 2 bits - resets I2C core
 	s->I2CBRLSB = 60;		// low 8 bits - (24MHz/100kHz)/4 = 60
-#else
-	s->reserved0 = 0xff;	// 0
-	s->reserved1 = 0xff;	// 1
-	s->reserved2 = 0xff;	// 2
-	s->I2CSADDR = 0xff;		// 3
-	s->reserved4 = 0xff;	// 4
-	s->reserved5 = 0xff;	// 5
-	s->I2CIRQ = 0xff;		// 6
-	s->I2CIRQEN = 0xff;		// 7
-	s->I2CCR1 = 0xff;		// 8
-	s->I2CCMDR = 0xff;		// 9
-	s->I2CBRLSB = 0xff;		// A
-	s->I2CBRMSB = 0xff;		// B
-	s->I2CSR = 0xff;		// C
-	s->I2CTXDR = 0xff;		// D
-	s->I2CRXDR = 0xff;		// E
-	s->I2CGCDR = 0xff;		// F
-
-#endif
+	s->I2CIRQ = 0xff;
+	
+	/* ports have their own queues so each bus runs independently */
+	irq_register((s == I2C1) ? IRQ_I2C1 : IRQ_I2C0,
+		(s == I2C1) ? i2c1_isr : i2c0_isr);
 }
 
 /*
- * i2c transmit bytes to addr
+ * queue a transaction, returns 0 or -1 if it has nothing to do. The
+ * callback, if any, runs in interrupt context.
  */
-int8_t i2c_tx(I2C_TypeDef *s, uint8_t addr, uint8_t *data, uint8_t sz)
+int i2c_submit(I2C_TypeDef *s, i2c_xfer *x)
 {
-	uint8_t err = 0;
-	uint8_t stat;
-	uint32_t timeout;
+	i2c_port *p = i2c_port_of(s);
+	uint32_t mask;
 	
-	/* diagnostic flag for I2C activity */
-	gp_out |= 1;
+	if(!x->wlen && !x->rlen)
+		return -1;
 	
-	/* transmit address and no read bit */
-	s->I2CTXDR = addr<<1;
-	s->I2CCMDR = I2C_CMD_STA | I2C_CMD_WR | I2C_CMD_CKSDIS;
-
-	/* loop over data */
-	while(sz--)
-	{
-		/* wait for TRRDY */
-		timeout = 3000;
-		while(timeout--)
-		{
-			if(s->I2CSR & I2C_SR_TRRDY)
-				break;
-		}
-		if(!timeout)
-			err = 3;
-		
-		/* transmit data */
-		s->I2CTXDR = *data++;
-		s->I2CCMDR = I2C_CMD_WR | I2C_CMD_CKSDIS;
-	}
+	x->status = I2C_BUSY;
+	x->next = 0;
 	
-	/* wait for TRRDY */
-	timeout = 3000;
-	while(timeout--)
+	mask = irq_save();
+	if(p->tail)
+		p->tail->next = x;
+	else
 	{
-		if(s->I2CSR & I2C_SR_TRRDY)
-			break;
+		p->head = x;
+		if(!p->stopping)
+			i2c_start(p);
 	}
-	if(!timeout)
-		err = 3;
-		
-	/* send stop after last byte */
-	s->I2CCMDR = I2C_CMD_STO | I2C_CMD_CKSDIS;
+	p->tail = x;
+	irq_restore(mask);
+	
+	return 0;
+}
+
+/*
+ * wait for a transaction to finish, giving up if the bus is stuck
+ */
+int8_t i2c_wait(I2C_TypeDef *s, i2c_xfer *x)
+{
+	i2c_port *p = i2c_port_of(s);
+	i2c_xfer *prev;
+	uint32_t t, mask;
+	
+	t = clkcnt_deadline((x->wlen + x->rlen + 2) * I2C_BYTE_CLKS);
+	while((x->status == I2C_BUSY) && !clkcnt_expired(t));
 	
-	/* check for error */
-	stat = s->I2CSR;
-	if(stat & I2C_SR_RARC)
+	mask = irq_save();
+	if(x->status == I2C_BUSY)
 	{
-		if(stat & I2C_SR_TROE)
+		if(p->head == x)
 		{
-			/* overrun + NACK */
-			printf("i2c_tx: overrun error, status = %02X, resetting\n\r", s->I2CSR);
-			err = 2;
-			
-			/* reset the core */
+			/* stuck on the bus - reset the core & move on */
 			s->I2CBRMSB = 0;
+			i2c_finish(p, I2C_TIMEOUT);
 		}
 		else
 		{
-			/* just a nack */
-			err = 1;
+			/* queued behind a stuck one - unlink it */
+			for(prev=p->head;prev->next!=x;prev=prev->next);
+			prev->next = x->next;
+			if(p->tail == x)
+				p->tail = prev;
+			x->status = I2C_TIMEOUT;
 		}
 	}
+	irq_restore(mask);
 	
-	/* drop flag */
-	gp_out &= ~1;
+	return x->status;
+}
+
+/*
+ * blocking write then read, either length may be 0
+ */
+int8_t i2c_txrx(I2C_TypeDef *s, uint8_t addr, uint8_t *wdata, uint8_t wsz,
+	uint8_t *rdata, uint8_t rsz)
+{
+	i2c_xfer x;
 	
-	return err;
-}
\ No newline at end of file
+	x.addr = addr;
+	x.wbuf = wdata;
+	x.wlen = wsz;
+	x.rbuf = rdata;
+	x.rlen = rsz;
+	x.done = 0;
+	if(i2c_submit(s, &x))
+		return I2C_OK;
+	
+	return i2c_wait(s, &x);
+}
+
+/*
+ * i2c transmit bytes to addr
+ */
+int8_t i2c_tx(I2C_TypeDef *s, uint8_t addr, uint8_t *data, uint8_t sz)
+{
+	return i2c_txrx(s, addr, data, sz, 0, 0);
+}
+
+/*
+ * i2c receive bytes from addr
+ */
+int8_t i2c_rx(I2C_TypeDef *s, uint8_t addr, uint8_t *data, uint8_t sz)
+{
+	return i2c_txrx(s, addr, 0, 0, data, sz);
+}
@@ -8,9 +8,41 @@
 
 #include "up5k_riscv.h"
 
+/* transaction status */
+#define I2C_OK 0
+#define I2C_NACK 1
+#define I2C_ERR 2
+#define I2C_TIMEOUT 3
+#define I2C_BUSY -1
+
+struct i2c_xfer;
+typedef void (*i2c_fn)(struct i2c_xfer *x);
+
+/*
+ * one transaction - writes wlen bytes then, after a repeated start, reads
+ * rlen bytes. Either length may be 0. Owned by the driver from
+ * i2c_submit() until status leaves I2C_BUSY.
+ */
+typedef struct i2c_xfer
+{
+	uint8_t addr;				// 7-bit slave address
+	uint8_t wlen;				// bytes to write
+	uint8_t rlen;				// bytes to read
+	volatile int8_t status;		// I2C_BUSY until done
+	uint8_t *wbuf;				// write data
+	uint8_t *rbuf;				// read data
+	i2c_fn done;				// called from the IRQ when finished, or 0
+	void *arg;					// for the callback
+	struct i2c_xfer *next;		// queue link
+} i2c_xfer;
+
 /* i2c functions */
 void i2c_init(I2C_TypeDef *s);
+int i2c_submit(I2C_TypeDef *s, i2c_xfer *x);
+int8_t i2c_wait(I2C_TypeDef *s, i2c_xfer *x);
 int8_t i2c_tx(I2C_TypeDef *s, uint8_t addr, uint8_t *data, uint8_t sz);
+int8_t i2c_rx(I2C_TypeDef *s, uint8_t addr, uint8_t *data, uint8_t sz);
+int8_t i2c_txrx(I2C_TypeDef *s, uint8_t addr, uint8_t *wdata, uint8_t wsz,
+	uint8_t *rdata, uint8_t rsz);
 
 #endif
-
@@ -9,11 +9,19 @@
 #include "clkcnt.h"
 #include "font_8x8.h"
 
-#define ILI9341_DC_CMD()    (gp_out&=~(1<<30))
-#define ILI9341_DC_DATA()   (gp_out|=(1<<30))
+#define ILI9341_DC_BIT      (1<<30)
+#define ILI9341_DC_CMD()    (gp_out&=~ILI9341_DC_BIT)
+#define ILI9341_DC_DATA()   (gp_out|=ILI9341_DC_BIT)
 #define ILI9341_RST_LOW()   (gp_out&=~(1<<31))
 #define ILI9341_RST_HIGH()  (gp_out|=(1<<31))
 
+/* the benchmark testbench has no panel to wait for */
+#ifdef BENCH_SUITE
+#define ili9341_delayms(ms) ((void)(ms))
+#else
+#define ili9341_delayms(ms) clkcnt_delayms(ms)
+#endif
+
 #define ILI9341_CMD 0x100
 #define ILI9341_DLY 0x200
 #define ILI9341_END 0x400
@@ -125,68 +133,244 @@ const static uint16_t initlst[] = {
 	ILI9341_END                    // END
 };
 
-/* pointer to SPI port */
+/* pointer to SPI port & the LCD's device settings on it */
 SPI_TypeDef *ili9341_spi;
+static spi_dev ili9341_dev;
+
+/* command stream - bit 8 set marks a command byte */
+#define ILI9341_STREAM_SZ 32
+static uint16_t ili9341_stream[ILI9341_STREAM_SZ];
+static uint8_t ili9341_stream_len;
+
+/* last address window sent - x0, x1, y0, y1 */
+static uint16_t ili9341_win[4];
+
+/* off-screen framebuffer - palette indices for a region of the panel */
+static struct
+{
+	uint8_t *buf;							/* w*h indices, NULL = direct */
+	int16_t x, y, w, h;						/* region on the panel */
+	int16_t dmin[ILI9341_TFTHEIGHT];		/* dirty span per row, */
+	int16_t dmax[ILI9341_TFTHEIGHT];		/* clean when dmin > dmax */
+	uint16_t pal[256];						/* rgb565, byte-swapped for SPI */
+	uint16_t npal;							/* palette entries in use */
+	uint16_t last_col;						/* last color lookup */
+	uint8_t last_idx;
+} ili9341_fb;
+
+/* double-buffered rgb565 rows for flushing */
+static uint16_t ili9341_line[2][ILI9341_TFTWIDTH];
 
 /*
- * send single byte via SPI - cmd or data depends on bit 8
+ * queue a command (bit 8 set) or data byte on the command stream
  */
-void ili9341_write(uint16_t dat)
+static void ili9341_put(uint16_t dat)
 {
-	if((dat&ILI9341_CMD) == ILI9341_CMD)
-		ILI9341_DC_CMD();
-	else
-		ILI9341_DC_DATA();
+	if(ili9341_stream_len == ILI9341_STREAM_SZ)
+		ili9341_send();
+	
+	ili9341_stream[ili9341_stream_len++] = dat;
+}
+
+#ifdef LCD_SPI
+/* free FIFO entries in the fabric LCD master last time we looked */
+static uint16_t ili9341_room;
+
+/*
+ * queue an entry on the fabric LCD master, only reading the FIFO level
+ * when the last known free space is used up
+ */
+static void ili9341_push(volatile uint32_t *reg, uint32_t dat)
+{
+	while(!ili9341_room)
+		ili9341_room = LCD_FIFO_DEPTH - LCD_STAT_LEVEL(LCD->CTRL);
+	
+	ili9341_room--;
+	*reg = dat;
+}
+
+/*
+ * queue the command stream - the fabric master handles CS and DC
+ */
+void ili9341_send(void)
+{
+	uint16_t *p = ili9341_stream, dat;
+	
+	while(ili9341_stream_len)
+	{
+		dat = *p++;
+		ili9341_stream_len--;
+		
+		ili9341_push((dat&ILI9341_CMD) ? &LCD->CMD : &LCD->DAT8, dat&0xff);
+	}
+}
+
+/*
+ * finish a transfer - CS is released after the queued data goes out
+ */
+void ili9341_end(void)
+{
+	ili9341_push(&LCD->END, 0);
+}
+
+/*
+ * wait until everything queued has been sent
+ */
+static void ili9341_sync(void)
+{
+	while(LCD->CTRL & LCD_STAT_BUSY);
+}
+
+/*
+ * queue a byte buffer as pixel data
+ */
+static void ili9341_tx_start(uint8_t *src, uint32_t sz)
+{
+	uint32_t *w;
+	
+	/* picorv32 can't do unaligned words */
+	for(;sz && ((uint32_t)src&3);sz--)
+		ili9341_push(&LCD->DAT8, *src++);
+	
+	w = (uint32_t *)src;
+	for(;sz>=4;sz-=4)
+		ili9341_push(&LCD->RAW4, *w++);
+	
+	src = (uint8_t *)w;
+	while(sz--)
+		ili9341_push(&LCD->DAT8, *src++);
+}
+
+#define ili9341_tx_wait()
+#define ili9341_tx(src, sz) ili9341_tx_start(src, sz)
+#else
+/*
+ * send the command stream with CS held low, only changing DC between
+ * commands and their parameters. CS stays low for data that follows.
+ */
+void ili9341_send(void)
+{
+	uint16_t *p = ili9341_stream, dat;
+	uint32_t dc;
+	
+	spi_dev_select(&ili9341_dev);
+	while(ili9341_stream_len)
+	{
+		dat = *p++;
+		ili9341_stream_len--;
+		
+		/* DC is sampled with the last bit so let the previous byte finish */
+		dc = (dat&ILI9341_CMD) ? 0 : ILI9341_DC_BIT;
+		if((gp_out&ILI9341_DC_BIT) != dc)
+		{
+			spi_idle_wait(ili9341_spi);
+			gp_out ^= ILI9341_DC_BIT;
+		}
+		
+		spi_tx_wait(ili9341_spi);
+		ili9341_spi->SPITXDR = dat&0xff;
+	}
+}
+
+/*
+ * finish a transfer - wait for the last byte and release CS
+ */
+void ili9341_end(void)
+{
+	spi_dev_release(&ili9341_dev);
+}
+
+#define ili9341_sync()
 
-	spi_tx_byte(ili9341_spi, dat&0xff);
+/*
+ * start a DMA of pixel data once the previous one is done
+ */
+static void ili9341_tx_start(uint8_t *src, uint32_t sz)
+{
+	spi_dma_wait();
+	spi_dma_start(ili9341_spi, src, 0, sz);
 }
 
+#define ili9341_tx_wait() spi_dma_wait()
+#define ili9341_tx(src, sz) spi_dma_transmit(ili9341_spi, src, sz)
+#endif
+
 /*
  * initialize the LCD
  */
 void ili9341_init(SPI_TypeDef *s)
 {
-	// save SPI port
+	// save SPI port, LCD is on CS0 at the spi_init() clock
 	ili9341_spi = s;
+	spi_dev_init(&ili9341_dev, s, 0, 0x02, SPI_MODE0);
+	ili9341_stream_len = 0;
 	
 	// Reset it
 	ILI9341_RST_LOW();
-	clkcnt_delayms(50);
+	ili9341_delayms(50);
 	ILI9341_RST_HIGH();
-	clkcnt_delayms(50);
+	ili9341_delayms(50);
 
-	// Send init command list
+	// Send init command list, one stream between delays
 	uint16_t *addr = (uint16_t *)initlst, ms;
 	while(*addr != ILI9341_END)
 	{
 		if((*addr & ILI9341_DLY) != ILI9341_DLY)
-			ili9341_write(*addr++);
+			ili9341_put(*addr++);
 		else
 		{
+			ili9341_send();
+			ili9341_end();
+			ili9341_sync();
 			ms = (*addr++)&0x1ff;        // strip delay time (ms)
-			clkcnt_delayms(ms);
+			ili9341_delayms(ms);
 		}	
 	}	
+	ili9341_send();
+	ili9341_end();
+	
+	// panel window is unknown after reset
+	ili9341_win[0] = 0xffff;
+	ili9341_win[2] = 0xffff;
 }
 
 /*
- * opens a window into display mem for bitblt
+ * opens a window into display mem for bitblt. Column and row addresses
+ * are only sent when they differ from the last window. Leaves CS low
+ * and DC in data mode - finish with ili9341_end().
  */
 void ili9341_setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
 {
-	ili9341_write(ILI9341_CASET | ILI9341_CMD); // Column addr set
-	ili9341_write(x0>>8);
-	ili9341_write(x0&0xff);     // XSTART 
-	ili9341_write(x1>>8);
-	ili9341_write(x1&0xff);     // XEND
+	if((x0 != ili9341_win[0]) || (x1 != ili9341_win[1]))
+	{
+		ili9341_put(ILI9341_CASET | ILI9341_CMD); // Column addr set
+		ili9341_put(x0>>8);
+		ili9341_put(x0&0xff);     // XSTART 
+		ili9341_put(x1>>8);
+		ili9341_put(x1&0xff);     // XEND
+		ili9341_win[0] = x0;
+		ili9341_win[1] = x1;
+	}
 
-	ili9341_write(ILI9341_RASET | ILI9341_CMD); // Row addr set
-	ili9341_write(y0>>8);
-	ili9341_write(y0&0xff);     // YSTART
-	ili9341_write(y1>>8);
-	ili9341_write(y1&0xff);     // YEND
+	if((y0 != ili9341_win[2]) || (y1 != ili9341_win[3]))
+	{
+		ili9341_put(ILI9341_RASET | ILI9341_CMD); // Row addr set
+		ili9341_put(y0>>8);
+		ili9341_put(y0&0xff);     // YSTART
+		ili9341_put(y1>>8);
+		ili9341_put(y1&0xff);     // YEND
+		ili9341_win[2] = y0;
+		ili9341_win[3] = y1;
+	}
 
-	ili9341_write(ILI9341_RAMWR | ILI9341_CMD); // write to RAM
+	// always needed - restarts the write at the window origin
+	ili9341_put(ILI9341_RAMWR | ILI9341_CMD); // write to RAM
+	ili9341_send();
+	
+#ifndef LCD_SPI
+	spi_idle_wait(ili9341_spi);
+	ILI9341_DC_DATA();
+#endif
 }
 
 /*
@@ -287,6 +471,17 @@ uint16_t ili9342_Color565(uint8_t r, uint8_t g, uint8_t b)
  */
 void ili9342_fillcolor(uint16_t color, uint32_t sz)
 {
+#ifdef LCD_SPI
+	uint32_t n;
+	
+	/* one FIFO entry per 64k pixels */
+	while(sz)
+	{
+		n = (sz > 0x10000) ? 0x10000 : sz;
+		ili9341_push(&LCD->FILL, ((n&0xffff)<<16) | color);
+		sz -= n;
+	}
+#else
 	uint8_t lo = color&0xff, hi = color>>8;
 	
 	while(sz--)
@@ -303,6 +498,233 @@ void ili9342_fillcolor(uint16_t color, uint32_t sz)
 		/* transmit hi byte */
 		ili9341_spi->SPITXDR = lo;
 	}
+#endif
+}
+
+/*
+ * byte swap a color so it goes out high byte first
+ */
+static uint16_t ili9341_swap16(uint16_t c)
+{
+	return (c>>8) | (c<<8);
+}
+
+/*
+ * map a color to a palette index, adding it if there's room or falling
+ * back to the nearest entry when the palette is full
+ */
+static uint8_t ili9341_fb_index(uint16_t color)
+{
+	uint16_t sc = ili9341_swap16(color), i, best = 0;
+	int32_t dr, dg, db, d, bestd = 0x7fffffff;
+	
+	if(sc == ili9341_fb.last_col)
+		return ili9341_fb.last_idx;
+	
+	for(i=0;i<ili9341_fb.npal;i++)
+		if(ili9341_fb.pal[i] == sc)
+			break;
+	
+	if(i == ili9341_fb.npal)
+	{
+		if(i < 256)
+			ili9341_fb.pal[ili9341_fb.npal++] = sc;
+		else
+		{
+			for(i=0;i<256;i++)
+			{
+				d = ili9341_swap16(ili9341_fb.pal[i]);
+				dr = ((d>>11)&0x1f) - ((color>>11)&0x1f);
+				dg = ((d>>5)&0x3f) - ((color>>5)&0x3f);
+				db = (d&0x1f) - (color&0x1f);
+				d = 4*dr*dr + dg*dg + 4*db*db;
+				if(d < bestd)
+				{
+					bestd = d;
+					best = i;
+				}
+			}
+			i = best;
+		}
+	}
+	
+	ili9341_fb.last_col = sc;
+	ili9341_fb.last_idx = i;
+	return i;
+}
+
+/*
+ * merge a region-relative rectangle into the row dirty spans
+ */
+static void ili9341_fb_dirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+{
+	int16_t y;
+	
+	for(y=y0;y<=y1;y++)
+	{
+		if(x0 < ili9341_fb.dmin[y])
+			ili9341_fb.dmin[y] = x0;
+		if(x1 > ili9341_fb.dmax[y])
+			ili9341_fb.dmax[y] = x1;
+	}
+}
+
+/*
+ * clip a panel rectangle to the framebuffer region, returns 0 if empty
+ */
+static uint8_t ili9341_fb_clip(int16_t *x, int16_t *y, int16_t *w, int16_t *h)
+{
+	*x -= ili9341_fb.x;
+	*y -= ili9341_fb.y;
+	if(*x < 0)
+	{
+		*w += *x;
+		*x = 0;
+	}
+	if(*y < 0)
+	{
+		*h += *y;
+		*y = 0;
+	}
+	if(*x + *w > ili9341_fb.w)
+		*w = ili9341_fb.w - *x;
+	if(*y + *h > ili9341_fb.h)
+		*h = ili9341_fb.h - *y;
+	
+	return (*w > 0) && (*h > 0);
+}
+
+/*
+ * fill a panel rectangle in the framebuffer
+ */
+static void ili9341_fb_fill(int16_t x, int16_t y, int16_t w, int16_t h,
+	uint16_t color)
+{
+	uint8_t idx, *row;
+	int16_t i, j;
+	
+	if(!ili9341_fb_clip(&x, &y, &w, &h))
+		return;
+	
+	idx = ili9341_fb_index(color);
+	row = ili9341_fb.buf + y*ili9341_fb.w + x;
+	for(j=0;j<h;j++)
+	{
+		for(i=0;i<w;i++)
+			row[i] = idx;
+		row += ili9341_fb.w;
+	}
+	
+	ili9341_fb_dirty(x, y, x+w-1, y+h-1);
+}
+
+/*
+ * draw into a buffer covering part of the panel instead of the panel
+ * itself. buf holds w*h bytes, NULL returns to direct drawing. Drawing
+ * is clipped to the region and reaches the panel on ili9341_flush().
+ */
+void ili9341_fb_init(uint8_t *buf, int16_t x, int16_t y, int16_t w, int16_t h)
+{
+	int16_t i;
+	
+	ili9341_fb.buf = buf;
+	if(!buf)
+		return;
+	
+	if(x + w > ILI9341_TFTWIDTH)
+		w = ILI9341_TFTWIDTH - x;
+	if(y + h > ILI9341_TFTHEIGHT)
+		h = ILI9341_TFTHEIGHT - y;
+	ili9341_fb.x = x;
+	ili9341_fb.y = y;
+	ili9341_fb.w = w;
+	ili9341_fb.h = h;
+	
+	/* palette starts with black, which the buffer is cleared to */
+	ili9341_fb.pal[0] = ILI9341_BLACK;
+	ili9341_fb.npal = 1;
+	ili9341_fb.last_col = ILI9341_BLACK;
+	ili9341_fb.last_idx = 0;
+	
+	for(i=0;i<h;i++)
+	{
+		ili9341_fb.dmin[i] = ILI9341_TFTWIDTH;
+		ili9341_fb.dmax[i] = -1;
+	}
+	ili9341_fb_fill(x, y, w, h, ILI9341_BLACK);
+}
+
+/*
+ * send one band of rows, expanding each row while the previous one
+ * goes out by DMA
+ */
+static void ili9341_fb_send(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+{
+	int16_t w = x1-x0+1, i, y;
+	uint8_t *src, b = 0;
+	uint16_t *dst;
+	
+	ili9341_setAddrWindow(ili9341_fb.x+x0, ili9341_fb.y+y0,
+		ili9341_fb.x+x1, ili9341_fb.y+y1);
+	
+	src = ili9341_fb.buf + y0*ili9341_fb.w + x0;
+	for(y=y0;y<=y1;y++)
+	{
+		dst = ili9341_line[b];
+		for(i=0;i<w;i++)
+			dst[i] = ili9341_fb.pal[src[i]];
+		src += ili9341_fb.w;
+		
+		ili9341_tx_start((uint8_t *)dst, w*sizeof(uint16_t));
+		b ^= 1;
+		
+		ili9341_fb.dmin[y] = ILI9341_TFTWIDTH;
+		ili9341_fb.dmax[y] = -1;
+	}
+	ili9341_tx_wait();
+	ili9341_end();
+}
+
+/*
+ * send dirty parts of the framebuffer to the panel. Consecutive dirty
+ * rows share one address window as long as the clean pixels that adds
+ * cost less than opening another window.
+ */
+void ili9341_flush(void)
+{
+	int16_t y, y0, x0, x1, nx0, nx1;
+	uint32_t used, rw;
+	
+	if(!ili9341_fb.buf)
+		return;
+	
+	y = 0;
+	while(y < ili9341_fb.h)
+	{
+		if(ili9341_fb.dmin[y] > ili9341_fb.dmax[y])
+		{
+			y++;
+			continue;
+		}
+		
+		y0 = y;
+		x0 = ili9341_fb.dmin[y];
+		x1 = ili9341_fb.dmax[y];
+		used = x1-x0+1;
+		while((++y < ili9341_fb.h) && (ili9341_fb.dmin[y] <= ili9341_fb.dmax[y]))
+		{
+			nx0 = ili9341_fb.dmin[y] < x0 ? ili9341_fb.dmin[y] : x0;
+			nx1 = ili9341_fb.dmax[y] > x1 ? ili9341_fb.dmax[y] : x1;
+			rw = ili9341_fb.dmax[y] - ili9341_fb.dmin[y] + 1;
+			if((uint32_t)(nx1-nx0+1)*(y-y0+1) - (used+rw) > ILI9341_FB_WINCOST)
+				break;
+			x0 = nx0;
+			x1 = nx1;
+			used += rw;
+		}
+		
+		ili9341_fb_send(x0, y0, x1, y-1);
+	}
 }
 
 /*
@@ -311,14 +733,17 @@ void ili9342_fillcolor(uint16_t color, uint32_t sz)
 void ili9341_drawPixel(int16_t x, int16_t y, uint16_t color)
 {
 
-	if((x < 0) ||(x >= ILI9341_TFTWIDTH) || (y < 0) || (y >= ILI9341_TFTHEIGHT)) return;
+	if(ili9341_fb.buf)
+	{
+		ili9341_fb_fill(x, y, 1, 1, color);
+		return;
+	}
 
-	ili9341_setAddrWindow(x,y,x+1,y+1);
+	if((x < 0) ||(x >= ILI9341_TFTWIDTH) || (y < 0) || (y >= ILI9341_TFTHEIGHT)) return;
 
-	ILI9341_DC_DATA();
-	spi_cs_low(ili9341_spi);
+	ili9341_setAddrWindow(x, y, x, y);
     ili9342_fillcolor(color, 1);
-	spi_cs_high(ili9341_spi);
+	ili9341_end();
 }
 
 /*
@@ -402,15 +827,18 @@ void ili9341_drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
  */
 void ili9341_drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
 {
+	if(ili9341_fb.buf)
+	{
+		ili9341_fb_fill(x, y, 1, h, color);
+		return;
+	}
+
 	// clipping
 	if((x >= ILI9341_TFTWIDTH) || (y >= ILI9341_TFTHEIGHT)) return;
 	if((y+h-1) >= ILI9341_TFTHEIGHT) h = ILI9341_TFTHEIGHT-y;
 	ili9341_setAddrWindow(x, y, x, y+h-1);
-
-	ILI9341_DC_DATA();
-	spi_cs_low(ili9341_spi);
 	ili9342_fillcolor(color, h);
-	spi_cs_high(ili9341_spi);
+	ili9341_end();
 }
 
 /*
@@ -418,15 +846,18 @@ void ili9341_drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
  */
 void ili9341_drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
 {
+	if(ili9341_fb.buf)
+	{
+		ili9341_fb_fill(x, y, w, 1, color);
+		return;
+	}
+
 	// clipping
 	if((x >= ILI9341_TFTWIDTH) || (y >= ILI9341_TFTHEIGHT)) return;
 	if((x+w-1) >= ILI9341_TFTWIDTH)  w = ILI9341_TFTWIDTH-x;
 	ili9341_setAddrWindow(x, y, x+w-1, y);
-
-	ILI9341_DC_DATA();
-	spi_cs_low(ili9341_spi);
 	ili9342_fillcolor(color, w);
-	spi_cs_high(ili9341_spi);
+	ili9341_end();
 }
 
 /*
@@ -449,17 +880,20 @@ void ili9341_emptyRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t colo
 void ili9341_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
 	uint16_t color)
 {
+	if(ili9341_fb.buf)
+	{
+		ili9341_fb_fill(x, y, w, h, color);
+		return;
+	}
+
 	// clipping
 	if((x >= ILI9341_TFTWIDTH) || (y >= ILI9341_TFTHEIGHT)) return;
 	if((x + w - 1) >= ILI9341_TFTWIDTH)  w = ILI9341_TFTWIDTH  - x;
 	if((y + h - 1) >= ILI9341_TFTHEIGHT) h = ILI9341_TFTHEIGHT - y;
 
 	ili9341_setAddrWindow(x, y, x+w-1, y+h-1);
-
-	ILI9341_DC_DATA();
-	spi_cs_low(ili9341_spi);
 	ili9342_fillcolor(color, h*w);
-	spi_cs_high(ili9341_spi);
+	ili9341_end();
 }
 
 /*
@@ -470,6 +904,36 @@ void ili9341_fillScreen(uint16_t color)
 	ili9341_fillRect(0, 0, 240, 320, color);
 }
 
+/*
+ * Draw character into the framebuffer
+ */
+static void ili9341_fb_drawchar(int16_t x, int16_t y, uint8_t chr,
+	uint16_t fg, uint16_t bg)
+{
+	int16_t cx = x, cy = y, w = 8, h = 8, i, j;
+	uint8_t fi = ili9341_fb_index(fg), bi = ili9341_fb_index(bg), d, *row;
+	
+	if(!ili9341_fb_clip(&cx, &cy, &w, &h))
+		return;
+	
+	/* offset into the glyph when clipped on the left or top */
+	x = cx - (x - ili9341_fb.x);
+	y = cy - (y - ili9341_fb.y);
+	row = ili9341_fb.buf + cy*ili9341_fb.w + cx;
+	for(j=0;j<h;j++)
+	{
+		d = fontdata[(chr<<3)+y+j] << x;
+		for(i=0;i<w;i++)
+		{
+			row[i] = (d&0x80) ? fi : bi;
+			d <<= 1;
+		}
+		row += ili9341_fb.w;
+	}
+	
+	ili9341_fb_dirty(cx, cy, cx+w-1, cy+h-1);
+}
+
 /*
  * Draw character direct to the display
  */
@@ -479,10 +943,14 @@ void ili9341_drawchar(int16_t x, int16_t y, uint8_t chr,
 	uint16_t i, j, col;
 	uint8_t d;
 	
+	if(ili9341_fb.buf)
+	{
+		ili9341_fb_drawchar(x, y, chr, fg, bg);
+		return;
+	}
+	
 	ili9341_setAddrWindow(x, y, x+7, y+7);
 	
-	ILI9341_DC_DATA();
-	spi_cs_low(ili9341_spi);
 	for(i=0;i<8;i++)
 	{
 		d = fontdata[(chr<<3)+i];
@@ -499,7 +967,7 @@ void ili9341_drawchar(int16_t x, int16_t y, uint8_t chr,
 			d <<= 1;
 		}
 	}
-	spi_cs_high(ili9341_spi);
+	ili9341_end();
 }
 
 // draw a string to the display
@@ -518,7 +986,7 @@ void ili9341_drawstr(int16_t x, int16_t y, char *str,
 }
 
 /*
- * send a buffer to the LCD
+ * send a buffer to the LCD - always direct, even with a framebuffer
  */
 void ili9341_blit(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *src)
 {
@@ -528,10 +996,7 @@ void ili9341_blit(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *src)
 	if((y + h - 1) >= ILI9341_TFTHEIGHT) h = ILI9341_TFTHEIGHT - y;
 
 	ili9341_setAddrWindow(x, y, x+w-1, y+h-1);
-
-	ILI9341_DC_DATA();
-	spi_cs_low(ili9341_spi);
-	spi_transmit(ili9341_spi, (uint8_t *)src, h*w*sizeof(uint16_t));
-	spi_cs_high(ili9341_spi);
+	ili9341_tx((uint8_t *)src, h*w*sizeof(uint16_t));
+	ili9341_end();
 }
 
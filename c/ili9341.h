@@ -22,7 +22,14 @@
 #define ILI9341_TFTWIDTH  240
 #define ILI9341_TFTHEIGHT 320
 
+// framebuffer flush merges rows while this many extra pixels or fewer
+// are sent - roughly the cost of a new address window
+#define ILI9341_FB_WINCOST 64
+
 void ili9341_init(SPI_TypeDef *s);
+void ili9341_send(void);
+void ili9341_end(void);
+void ili9341_setAddrWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
 void ili9341_drawPixel(int16_t x, int16_t y, uint16_t color);
 void ili9341_drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
 void ili9341_drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
@@ -40,5 +47,7 @@ void ili9341_drawchar(int16_t x, int16_t y, uint8_t chr,
 void ili9341_drawstr(int16_t x, int16_t y, char *str,
 	uint16_t fg, uint16_t bg);
 void ili9341_blit(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *src);
+void ili9341_fb_init(uint8_t *buf, int16_t x, int16_t y, int16_t w, int16_t h);
+void ili9341_flush(void);
 #endif
 
@@ -0,0 +1,117 @@
+/*
+ * irq.c - interrupt controller driver
+ * 10-17-26 E. Brombaugh
+ */
+
+#include "irq.h"
+
+/* picorv32 IRQ line driven by the controller */
+#define IRQ_CPU_INTC (1<<3)
+
+/* per-source handlers */
+static irq_fn irq_table[IRQ_NUM];
+
+/*
+ * set picorv32 IRQ mask (1 = masked), returns previous mask
+ */
+uint32_t irq_setmask(uint32_t mask)
+{
+	register uint32_t a0 asm("a0") = mask;
+	
+	/* maskirq a0, a0 */
+	asm volatile (".word 0x0605650b" : "+r" (a0) : : "memory");
+	
+	return a0;
+}
+
+/*
+ * mask all IRQs for a critical section
+ */
+uint32_t irq_save(void)
+{
+	return irq_setmask(~0);
+}
+
+/*
+ * end a critical section
+ */
+void irq_restore(uint32_t mask)
+{
+	irq_setmask(mask);
+}
+
+/*
+ * clear controller and unmask its CPU line
+ */
+void irq_init(void)
+{
+	uint8_t i;
+	
+	INTC->ENABLE = 0;
+	INTC->PEND = ~0;
+	for(i=0;i<IRQ_NUM;i++)
+		irq_table[i] = 0;
+	
+	irq_setmask(~IRQ_CPU_INTC);
+}
+
+/*
+ * install a handler and enable its source
+ */
+void irq_register(uint8_t src, irq_fn fn)
+{
+	irq_table[src] = fn;
+	
+	if(fn)
+		irq_enable(src);
+	else
+		irq_disable(src);
+}
+
+/*
+ * enable a source
+ */
+void irq_enable(uint8_t src)
+{
+	uint32_t mask = irq_save();
+	
+	INTC->ENABLE |= 1<<src;
+	
+	irq_restore(mask);
+}
+
+/*
+ * disable a source
+ */
+void irq_disable(uint8_t src)
+{
+	uint32_t mask = irq_save();
+	
+	INTC->ENABLE &= ~(1<<src);
+	
+	irq_restore(mask);
+}
+
+/*
+ * called from the vector in start.S with the pending CPU IRQs
+ */
+void irq_handler(uint32_t irqs)
+{
+	uint32_t pend;
+	uint8_t i;
+	
+	if(!(irqs & IRQ_CPU_INTC))
+		return;
+	
+	pend = INTC->PEND & INTC->ENABLE;
+	for(i=0;i<IRQ_NUM;i++)
+	{
+		if(pend & (1<<i))
+		{
+			/* handler clears the source, then ack the pending bit */
+			if(irq_table[i])
+				irq_table[i]();
+			INTC->PEND = 1<<i;
+		}
+	}
+}
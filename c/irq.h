@@ -0,0 +1,32 @@
+/*
+ * irq.h - interrupt controller driver
+ * 10-17-26 E. Brombaugh
+ */
+
+#ifndef __irq__
+#define __irq__
+
+#include "up5k_riscv.h"
+
+/* interrupt controller sources - see intc in system.v */
+#define IRQ_ACIA 0
+#define IRQ_SPI0 1
+#define IRQ_SPI1 2
+#define IRQ_I2C0 3
+#define IRQ_TIMER 4
+#define IRQ_DMA 5
+#define IRQ_I2C1 6
+#define IRQ_NUM 8
+
+typedef void (*irq_fn)(void);
+
+void irq_init(void);
+void irq_register(uint8_t src, irq_fn fn);
+void irq_enable(uint8_t src);
+void irq_disable(uint8_t src);
+uint32_t irq_setmask(uint32_t mask);
+uint32_t irq_save(void);
+void irq_restore(uint32_t mask);
+void irq_handler(uint32_t irqs);
+
+#endif
@@ -0,0 +1,325 @@
+/*
+ * kvs.c - log-structured key/value store in SPI flash
+ * 10-17-26 E. Brombaugh
+ *
+ * Each sector starts with a magic word and a sequence number and is then
+ * an append-only log of records: {key, len, crc16} followed by the value
+ * padded to a word. A later record for a key supersedes earlier ones and
+ * len 0 deletes it. The sector after the head is always erased; when the
+ * head fills it becomes the new head and the oldest sector's live records
+ * are copied into it before that sector is erased. Sectors are used round
+ * the ring in turn so they wear evenly.
+ *
+ * At boot the sectors are scanned oldest first to rebuild a RAM index of
+ * where each key's current record is. The scan reads at most
+ * KVS_SECTORS * 1022 record headers. A sector without a header only
+ * counts as erased if all of it reads blank, since an erase cut short by
+ * power loss can leave the header clear and old records behind it.
+ */
+
+#include "kvs.h"
+#include "spi.h"
+#include "clkcnt.h"
+
+#define KVS_MAGIC 0x3153564B	// "KVS1"
+#define KVS_HDR 8				// sector header bytes
+#define KVS_ERASED 0xFF			// key of an unwritten record
+#define KVS_RECSZ(len) (4+(((len)+3)&~3))
+
+/* all live values must fit in a fresh sector for compaction to work */
+#if KVS_KEYS*KVS_RECSZ(KVS_VAL_MAX) > FLASH_SECTOR-KVS_HDR
+#error "KVS_KEYS values of KVS_VAL_MAX don't fit in one sector"
+#endif
+
+typedef struct
+{
+	uint8_t key;
+	uint8_t len;
+	uint16_t crc;
+} kvs_rec;
+
+/* RAM index - flash address of each key's record, 0 if none */
+static uint32_t kvs_addr[KVS_KEYS];
+static uint8_t kvs_len[KVS_KEYS];
+
+/* head sector, next free offset in it & its sequence number */
+static uint32_t kvs_head, kvs_off, kvs_seq;
+static kvs_info kvs_inf;
+
+/*
+ * flash address of a sector
+ */
+static uint32_t kvs_sect(uint32_t s)
+{
+	return KVS_BASE + s*FLASH_SECTOR;
+}
+
+/*
+ * CRC-16/CCITT over a record's key, len & value
+ */
+static uint16_t kvs_crc(uint8_t key, uint8_t len, const uint8_t *val)
+{
+	uint16_t crc = 0xffff;
+	uint32_t i, b, n = len + 2;
+	uint8_t d;
+	
+	for(i=0;i<n;i++)
+	{
+		d = (i==0) ? key : (i==1) ? len : val[i-2];
+		crc ^= d<<8;
+		for(b=0;b<8;b++)
+			crc = (crc & 0x8000) ? (crc<<1) ^ 0x1021 : crc<<1;
+	}
+	
+	return crc;
+}
+
+/*
+ * check a whole sector reads erased, returns 1 if so
+ */
+static int kvs_blank(uint32_t base)
+{
+	uint32_t buf[64], i, off;
+	
+	for(off=0;off<FLASH_SECTOR;off+=sizeof(buf))
+	{
+		flash_read(SPI0, (uint8_t *)buf, base + off, sizeof(buf));
+		for(i=0;i<sizeof(buf)/4;i++)
+			if(buf[i] != 0xffffffff)
+				return 0;
+	}
+	
+	return 1;
+}
+
+/*
+ * append a record to the head sector, caller has checked it fits
+ */
+static void kvs_append(uint8_t key, uint8_t len, const uint8_t *val)
+{
+	uint32_t buf[KVS_RECSZ(KVS_VAL_MAX)/4];
+	kvs_rec *r = (kvs_rec *)buf;
+	uint8_t *p = (uint8_t *)buf;
+	uint32_t i, sz = KVS_RECSZ(len);
+	
+	/* one program for header & value, padding left erased */
+	r->key = key;
+	r->len = len;
+	r->crc = kvs_crc(key, len, val);
+	for(i=0;i<len;i++)
+		p[4+i] = val[i];
+	for(;i<sz-4;i++)
+		p[4+i] = 0xff;
+	flash_write(SPI0, p, kvs_sect(kvs_head) + kvs_off, sz);
+	
+	kvs_addr[key] = len ? kvs_sect(kvs_head) + kvs_off : 0;
+	kvs_len[key] = len;
+	kvs_off += sz;
+}
+
+/*
+ * start a sector as the new head
+ */
+static void kvs_open(uint32_t s)
+{
+	uint32_t hdr[2];
+	
+	kvs_seq++;
+	hdr[0] = KVS_MAGIC;
+	hdr[1] = kvs_seq;
+	flash_write(SPI0, (uint8_t *)hdr, kvs_sect(s), KVS_HDR);
+	kvs_head = s;
+	kvs_off = KVS_HDR;
+}
+
+/*
+ * make the sector after the head the erased spare, moving live records
+ * out of it first. Safe to repeat if power failed part way through.
+ */
+static void kvs_reclaim(void)
+{
+	uint32_t s = (kvs_head + 1) % KVS_SECTORS, base = kvs_sect(s);
+	uint32_t hdr, k;
+	uint8_t val[KVS_VAL_MAX];
+	
+	flash_read(SPI0, (uint8_t *)&hdr, base, 4);
+	if((hdr == 0xffffffff) && kvs_blank(base))
+		return;
+	
+	/* only records the index still points at are live */
+	if(hdr == KVS_MAGIC)
+		for(k=0;k<KVS_KEYS;k++)
+			if((kvs_addr[k] >= base) && (kvs_addr[k] < base + FLASH_SECTOR))
+			{
+				flash_read(SPI0, val, kvs_addr[k] + 4, kvs_len[k]);
+				kvs_append(k, kvs_len[k], val);
+			}
+	
+	flash_erase(SPI0, base, FLASH_SECTOR);
+	kvs_inf.erases++;
+}
+
+/*
+ * scan one sector's log into the index, returns the offset past the last
+ * good record. A torn record ends the log and closes the sector.
+ */
+static uint32_t kvs_scan(uint32_t s)
+{
+	uint32_t base = kvs_sect(s), off = KVS_HDR;
+	uint8_t val[KVS_VAL_MAX];
+	kvs_rec r;
+	
+	while(off < FLASH_SECTOR)
+	{
+		flash_read(SPI0, (uint8_t *)&r, base + off, sizeof(r));
+		if(r.key == KVS_ERASED)
+			break;
+	
+		if((r.key >= KVS_KEYS) || (r.len > KVS_VAL_MAX) ||
+			(off + KVS_RECSZ(r.len) > FLASH_SECTOR))
+			return FLASH_SECTOR;
+		if(r.len)
+			flash_read(SPI0, val, base + off + 4, r.len);
+		if(kvs_crc(r.key, r.len, val) != r.crc)
+			return FLASH_SECTOR;
+	
+		kvs_addr[r.key] = r.len ? base + off : 0;
+		kvs_len[r.key] = r.len;
+		kvs_inf.records++;
+		off += KVS_RECSZ(r.len);
+	}
+	
+	return off;
+}
+
+/*
+ * mount the store, rebuilding the index. Returns 0.
+ */
+int kvs_init(void)
+{
+	uint32_t hdr[KVS_SECTORS][2], s, n, t = clkcnt_get();
+	int head = -1;
+	
+	for(s=0;s<KVS_KEYS;s++)
+		kvs_addr[s] = 0;
+	kvs_inf.records = 0;
+	kvs_inf.erases = 0;
+	kvs_seq = 0;
+	
+	/* find the newest sector, wiping any with a damaged header or a
+	   partly erased body */
+	for(s=0;s<KVS_SECTORS;s++)
+	{
+		flash_read(SPI0, (uint8_t *)hdr[s], kvs_sect(s), KVS_HDR);
+		if(hdr[s][0] == KVS_MAGIC)
+		{
+			if((head < 0) || (hdr[s][1] > kvs_seq))
+			{
+				head = s;
+				kvs_seq = hdr[s][1];
+			}
+		}
+		else if((hdr[s][0] != 0xffffffff) || !kvs_blank(kvs_sect(s)))
+		{
+			flash_erase(SPI0, kvs_sect(s), FLASH_SECTOR);
+			hdr[s][0] = 0xffffffff;
+			kvs_inf.erases++;
+		}
+	}
+	
+	if(head < 0)
+	{
+		/* empty store */
+		kvs_open(0);
+	}
+	else
+	{
+		/* ring order from just after the head is oldest first */
+		for(n=1;n<=KVS_SECTORS;n++)
+		{
+			s = (head + n) % KVS_SECTORS;
+			if(hdr[s][0] == KVS_MAGIC)
+				kvs_off = kvs_scan(s);
+		}
+		kvs_head = head;
+	}
+	
+	/* finish a reclaim interrupted by power loss */
+	kvs_reclaim();
+	
+	kvs_inf.boot_clks = clkcnt_elapsed(t);
+	return 0;
+}
+
+/*
+ * copy a value out, returns its length or -1 if the key has none
+ */
+int kvs_get(uint8_t key, void *val, uint32_t len)
+{
+	if((key >= KVS_KEYS) || !kvs_addr[key])
+		return -1;
+	
+	if(len > kvs_len[key])
+		len = kvs_len[key];
+	flash_read(SPI0, val, kvs_addr[key] + 4, len);
+	
+	return kvs_len[key];
+}
+
+/*
+ * store a value, len 0 deletes. Returns 0 or -1 if the key or length is
+ * out of range.
+ */
+int kvs_set(uint8_t key, const void *val, uint32_t len)
+{
+	uint8_t cur[KVS_VAL_MAX];
+	const uint8_t *v = val;
+	uint32_t i;
+	
+	if((key >= KVS_KEYS) || (len > KVS_VAL_MAX))
+		return -1;
+	
+	/* skip rewriting what's already there */
+	if(len == (kvs_addr[key] ? kvs_len[key] : 0))
+	{
+		if(!len)
+			return 0;
+		flash_read(SPI0, cur, kvs_addr[key] + 4, len);
+		for(i=0;(i<len) && (cur[i]==v[i]);i++);
+		if(i == len)
+			return 0;
+	}
+	
+	/* roll to the spare sector & reclaim the oldest when full */
+	if(kvs_off + KVS_RECSZ(len) > FLASH_SECTOR)
+	{
+		kvs_open((kvs_head + 1) % KVS_SECTORS);
+		kvs_reclaim();
+	}
+	
+	kvs_append(key, len, v);
+	return 0;
+}
+
+/*
+ * remove a key
+ */
+int kvs_del(uint8_t key)
+{
+	return kvs_set(key, 0, 0);
+}
+
+/*
+ * get boot time & usage
+ */
+void kvs_stats(kvs_info *info)
+{
+	uint32_t k;
+	
+	*info = kvs_inf;
+	info->live = 0;
+	for(k=0;k<KVS_KEYS;k++)
+		if(kvs_addr[k])
+			info->live++;
+	info->used = kvs_off;
+}
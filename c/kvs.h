@@ -0,0 +1,39 @@
+/*
+ * kvs.h - log-structured key/value store in SPI flash
+ * 10-17-26 E. Brombaugh
+ */
+
+#ifndef __kvs__
+#define __kvs__
+
+#include "up5k_riscv.h"
+#include "flash.h"
+
+/* flash region - a ring of 4kB sectors, one always kept erased */
+#ifndef KVS_BASE
+#define KVS_BASE 0x300000
+#endif
+#ifndef KVS_SECTORS
+#define KVS_SECTORS 4
+#endif
+
+/* keys are small integers so lookup is a table index */
+#define KVS_KEYS 32
+#define KVS_VAL_MAX 60
+
+typedef struct
+{
+	uint32_t boot_clks;		// time kvs_init() took
+	uint32_t records;		// records scanned at boot
+	uint32_t live;			// keys with a value
+	uint32_t used;			// bytes used in the head sector
+	uint32_t erases;		// sector erases since boot
+} kvs_info;
+
+int kvs_init(void);
+int kvs_get(uint8_t key, void *val, uint32_t len);
+int kvs_set(uint8_t key, const void *val, uint32_t len);
+int kvs_del(uint8_t key);
+void kvs_stats(kvs_info *info);
+
+#endif
@@ -12,6 +12,12 @@
 #include "clkcnt.h"
 #include "ili9341.h"
 #include "i2c.h"
+#include "irq.h"
+#include "kvs.h"
+#include "bench.h"
+
+/* printf output ring, drained by the serial tx IRQ */
+static uint8_t stdout_buf[2048];
 
 /*
  * main... duh
@@ -19,9 +25,19 @@
 void main()
 {
 	uint32_t cnt, spi_id, i, j;
+	i2c_xfer i2c_x;
+	uint8_t pend = 0;
 	//int c;
 	
+	irq_init();
+	clkcnt_init();
+	acia_txbuf_init(stdout_buf, sizeof(stdout_buf), ACIA_TX_BLOCK);
 	init_printf(0,acia_printf_putc);
+	
+#ifdef BENCH_SUITE
+	/* timed regions reported by the icarus testbench, which then stops */
+	bench_suite();
+#endif
 	printf("\n\n\rup5k_riscv - starting up\n\r");
 	
 	/* test both SPI ports */
@@ -32,6 +48,92 @@ void main()
 	flash_init(SPI0);	// wake up the flash chip
 	spi_id = flash_id(SPI0);
 	printf("spi flash id: 0x%08X\n\r", spi_id);
+	printf("flash read mode: 0x%04X\n\r", flash_getmode());
+	
+#if 0
+	/* flash read benchmark - one 240x320 image through each read path */
+	{
+		static uint16_t buf[ILI9341_TFTWIDTH*4];
+		static const uint32_t mode[] = {
+			0,								/* 0x03 on SB_SPI0 + DMA */
+			XIP_MODE(0x03, 0, 0),			/* fabric, READ */
+			XIP_MODE(0x0B, 8, 0),			/* fabric, fast read */
+			XIP_MODE(0x3B, 8, 1),			/* fabric, dual output */
+			XIP_MODE(0x6B, 8, 2),			/* fabric, quad output */
+		};
+		uint32_t k, n, t, sav = flash_getmode();
+		
+		n = ILI9341_TFTWIDTH*ILI9341_TFTHEIGHT*sizeof(uint16_t);
+		for(k=0;k<sizeof(mode)/sizeof(mode[0]);k++)
+		{
+			if((k == 4) && !(xip_ctrl & XIP_STAT_QUAD))
+				break;
+			flash_setmode(mode[k]);
+			t = clkcnt_get();
+			for(i=0;i<n;i+=sizeof(buf))
+				flash_read(SPI0, (uint8_t *)buf, 0x200000+i, sizeof(buf));
+			t = clkcnt_elapsed(t)/CLKCNT_US;
+			printf("read mode 0x%04X: %d bytes %d us %d.%02d MB/s\n\r",
+				mode[k], n, t, n/t, (n*100/t)%100);
+		}
+		flash_setmode(sav);
+	}
+#endif
+	
+#if 0
+	/* flash program test - unaligned multi-page write to scratch space */
+	{
+		static uint8_t pat[700];
+		uint32_t t;
+		
+		for(i=0;i<sizeof(pat);i++)
+			pat[i] = i*7+1;
+		t = clkcnt_get();
+		j = flash_program(SPI0, pat, 0x3F00F0, sizeof(pat));
+		t = clkcnt_elapsed(t)/CLKCNT_MS;
+		printf("flash program %d bytes: %s, %d ms\n\r", sizeof(pat),
+			j ? "FAIL" : "ok", t);
+	}
+#endif
+	
+#if 0
+	/* read cache - random small reads of font-sized glyphs */
+	{
+		static uint8_t cache[4096+256];
+		uint8_t glyph[8];
+		flash_cache_info inf;
+		uint32_t t, k;
+		
+		for(k=0;k<2;k++)
+		{
+			flash_cache_init(k ? cache : 0, sizeof(cache), 64);
+			t = clkcnt_get();
+			for(i=0;i<1000;i++)
+				flash_read(SPI0, glyph, 0x100000 + ((i*37)&127)*8, 8);
+			t = clkcnt_elapsed(t)/CLKCNT_US;
+			flash_cache_stats(&inf);
+			printf("%s: 1000 reads %d us, %d hits %d misses %d prefetched\n\r",
+				k ? "cached" : "uncached", t, inf.hits, inf.misses,
+				inf.prefetches);
+		}
+	}
+#endif
+	
+#if 0
+	/* persistent boot counter in the key/value store */
+	{
+		kvs_info inf;
+		uint32_t boots = 0;
+		
+		kvs_init();
+		kvs_get(0, &boots, sizeof(boots));
+		boots++;
+		kvs_set(0, &boots, sizeof(boots));
+		kvs_stats(&inf);
+		printf("boot %d: kvs mounted in %d us, %d records, %d keys, %d bytes\n\r",
+			boots, inf.boot_clks/CLKCNT_US, inf.records, inf.live, inf.used);
+	}
+#endif
 	
 #if 0
 	/* read some data */
@@ -68,6 +170,56 @@ void main()
 	clkcnt_delayms(1000);
 #endif
 	
+#if 0
+	/* frame rate benchmark - demo scenes direct vs. framebuffer */
+	{
+		static uint8_t fb[ILI9341_TFTWIDTH*160];
+		static char *mode[] = {"direct", "fb"};
+		char num[4];
+		uint32_t k, n, t;
+		
+		for(k=0;k<2;k++)
+		{
+			/* full redraw: fill, text, font & lines */
+			ili9341_fb_init(k ? fb : 0, 0, 0, ILI9341_TFTWIDTH, 160);
+			n = 10;
+			t = clkcnt_get();
+			for(i=0;i<n;i++)
+			{
+				ili9341_fillRect(0, 0, 240, 160, ILI9341_MAGENTA);
+				ili9341_drawstr(120-44, 8, "Hello World", ILI9341_WHITE,
+					ILI9341_MAGENTA);
+				for(j=0;j<128;j++)
+					ili9341_drawchar(56+(j&15)*8, 24+(j>>4)*8, j+i,
+						ILI9341_GREEN, ILI9341_BLACK);
+				for(j=0;j<240;j+=16)
+					ili9341_drawLine(j, 90, 239-j, 159, ILI9341_YELLOW);
+				ili9341_flush();
+			}
+			t = clkcnt_elapsed(t)/CLKCNT_MS;
+			printf("%s scene: %d frames %d ms %d fps x100\n\r", mode[k], n, t,
+				n*100000/t);
+			
+			/* partial update: a counter over the scene */
+			n = 200;
+			t = clkcnt_get();
+			for(i=0;i<n;i++)
+			{
+				num[0] = '0' + (i/100)%10;
+				num[1] = '0' + (i/10)%10;
+				num[2] = '0' + i%10;
+				num[3] = 0;
+				ili9341_drawstr(8, 8, num, ILI9341_WHITE, ILI9341_BLUE);
+				ili9341_flush();
+			}
+			t = clkcnt_elapsed(t)/CLKCNT_MS;
+			printf("%s update: %d frames %d ms %d fps x100\n\r", mode[k], n, t,
+				n*100000/t);
+		}
+		ili9341_fb_init(0, 0, 0, 0, 0);
+	}
+#endif
+	
 #if 0
 	/* test colored lines */
 	{
@@ -118,24 +270,39 @@ void main()
 	/* Test I2C */
 	i2c_init(I2C0);
 	printf("I2C0 Initialized\n\r");
+	i2c_init(I2C1);
+	printf("I2C1 Initialized\n\r");
 
+	/* one write per second, polled without blocking the loop */
 	cnt = 0;
+	i2c_x.addr = 0x1A;
+	i2c_x.wbuf = (uint8_t *)&cnt;
+	i2c_x.wlen = 2;
+	i2c_x.rlen = 0;
+	i2c_x.done = 0;
+	i2c_x.status = I2C_OK;
+	i = clkcnt_deadline(CLKCNT_HZ);
 	while(1)
 	{
-		gp_out = (gp_out&~(7<<17))|((cnt&7)<<17);
-		
-		if(i2c_tx(I2C0, 0x1A, (uint8_t *)&cnt, 2))
-			acia_putc('x');
-		else
-			acia_putc('.');
+		if(clkcnt_expired(i) && (i2c_x.status != I2C_BUSY))
+		{
+			i += CLKCNT_HZ;
+			gp_out = (gp_out&~(7<<17))|((cnt&7)<<17);
+			i2c_submit(I2C0, &i2c_x);
+			pend = 1;
+		}
 		
-		cnt++;
+		if(pend && (i2c_x.status != I2C_BUSY))
+		{
+			acia_txbuf_putc(i2c_x.status ? 'x' : '.');
+			cnt++;
+			pend = 0;
+		}
 		
 #if 0
 		/* simple echo */
 		if((c=acia_getc()) != EOF)
 			acia_putc(c);
 #endif		
-		clkcnt_delayms(1000);
 	}
 }
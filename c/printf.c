@@ -27,53 +27,69 @@ static void* stdout_putp;
 
 #define PRINTF_LONG_SUPPORT
 
-#ifdef PRINTF_LONG_SUPPORT
+/*
+ * Digits are made without dividing - rv32i has no divide or multiply so
+ * each / or % would be a libgcc call. Decimal subtracts 8, 4, 2 and 1
+ * times each power of ten, hex is shifts. long is 32 bits on this target
+ * so the long variants share the same code.
+ */
+static const unsigned int dec_pow[10] = {
+    1000000000, 100000000, 10000000, 1000000, 100000,
+    10000, 1000, 100, 10, 1
+    };
 
-static void uli2a(unsigned long int num, unsigned int base, int uc,char * bf)
+static char* u2dec(unsigned int num, char * bf)
     {
-    int n=0;
-    unsigned int d=1;
-    while (num/d >= base)
-        d*=base;         
-    while (d!=0) {
-        int dgt = num / d;
-        num%=d;
-        d/=base;
-        if (n || dgt>0|| d==0) {
-            *bf++ = dgt+(dgt<10 ? '0' : (uc ? 'A' : 'a')-10);
-            ++n;
+    const unsigned int* p=dec_pow;
+    unsigned int d, dgt;
+    while (*p > num && *p != 1)
+        p++;
+    do {
+        d = *p;
+        dgt = 0;
+        if (d <= 0x1fffffff && num >= d<<3) {
+            num -= d<<3;
+            dgt = 8;
             }
-        }
+        if (num >= d<<2) {
+            num -= d<<2;
+            dgt += 4;
+            }
+        if (num >= d<<1) {
+            num -= d<<1;
+            dgt += 2;
+            }
+        if (num >= d) {
+            num -= d;
+            dgt++;
+            }
+        *bf++ = '0'+dgt;
+        } while (*p++ != 1);
     *bf=0;
+    return bf;
     }
 
-static void li2a (long num, char * bf)
+static const char hex_lc[16] = "0123456789abcdef";
+static const char hex_uc[16] = "0123456789ABCDEF";
+
+static char* u2hex(unsigned int num, int uc, int n, char * bf)
     {
-    if (num<0) {
-        num=-num;
-        *bf++ = '-';
-        }
-    uli2a(num,10,0,bf);
+    const char* dg = uc ? hex_uc : hex_lc;
+    int s=28;
+    while (s && !(num>>s) && s >= n*4)
+        s-=4;
+    for (;s>=0;s-=4)
+        *bf++ = dg[(num>>s)&15];
+    *bf=0;
+    return bf;
     }
 
-#endif
-
 static void ui2a(unsigned int num, unsigned int base, int uc,char * bf)
     {
-    int n=0;
-    unsigned int d=1;
-    while (num/d >= base)
-        d*=base;        
-    while (d!=0) {
-        int dgt = num / d;
-        num%= d;
-        d/=base;
-        if (n || dgt>0 || d==0) {
-            *bf++ = dgt+(dgt<10 ? '0' : (uc ? 'A' : 'a')-10);
-            ++n;
-            }
-        }
-    *bf=0;
+    if (base==16)
+        u2hex(num,uc,0,bf);
+    else
+        u2dec(num,bf);
     }
 
 static void i2a (int num, char * bf)
@@ -85,6 +101,20 @@ static void i2a (int num, char * bf)
     ui2a(num,10,0,bf);
     }
 
+#ifdef PRINTF_LONG_SUPPORT
+
+static void uli2a(unsigned long int num, unsigned int base, int uc,char * bf)
+    {
+    ui2a(num,base,uc,bf);
+    }
+
+static void li2a (long num, char * bf)
+    {
+    i2a(num,bf);
+    }
+
+#endif
+
 static int a2d(char ch)
     {
     if (ch>='0' && ch<='9') 
@@ -111,6 +141,13 @@ static char a2i(char ch, char** src,int base,int* nump)
     return ch;
     }
 
+static void puts_(void* putp,putcf putf,char* bf)
+    {
+    char ch;
+    while ((ch= *bf++))
+        putf(putp,ch);
+    }
+
 static void putchw(void* putp,putcf putf,int n, char z, char* bf)
     {
     char fc=z? '0' : ' ';
@@ -164,7 +201,11 @@ void tfp_format(void* putp,putcf putf,char *fmt, va_list va)
                     else
 #endif
                     ui2a(va_arg(va, unsigned int),10,0,bf);
-                    putchw(putp,putf,w,lz,bf);
+                    /* no width - skip the padding pass */
+                    if (!w)
+                        puts_(putp,putf,bf);
+                    else
+                        putchw(putp,putf,w,lz,bf);
                     break;
                     }
                 case 'd' :  {
@@ -177,15 +218,28 @@ void tfp_format(void* putp,putcf putf,char *fmt, va_list va)
                     putchw(putp,putf,w,lz,bf);
                     break;
                     }
-                case 'x': case 'X' : 
+                case 'x': case 'X' : {
+                    unsigned int v;
 #ifdef  PRINTF_LONG_SUPPORT
                     if (lng)
-                        uli2a(va_arg(va, unsigned long int),16,(ch=='X'),bf);
+                        v=va_arg(va, unsigned long int);
                     else
 #endif
-                    ui2a(va_arg(va, unsigned int),16,(ch=='X'),bf);
-                    putchw(putp,putf,w,lz,bf);
+                    v=va_arg(va, unsigned int);
+                    /* zero padded to 8 or less - the digits are the padding */
+                    if (lz && w <= 8) {
+                        u2hex(v,(ch=='X'),w,bf);
+                        puts_(putp,putf,bf);
+                        }
+                    else {
+                        u2hex(v,(ch=='X'),0,bf);
+                        if (!w)
+                            puts_(putp,putf,bf);
+                        else
+                            putchw(putp,putf,w,lz,bf);
+                        }
                     break;
+                    }
                 case 'c' : 
                     putf(putp,(char)(va_arg(va, int)));
                     break;
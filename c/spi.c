@@ -6,6 +6,9 @@
 #include <stdio.h>
 #include "spi.h"
 
+/* device each core is currently set up for */
+static spi_dev *spi_cur[2];
+
 /*
  * initialize spi port
  */
@@ -16,14 +19,63 @@ void spi_init(SPI_TypeDef *s)
 	s->SPICR2 = 0xc0;	// master, hold cs low while busy
 	s->SPIBR = 0x02;	// divide clk by 3 for spi clk
 	s->SPICSR = 0x0f;	// all CS outs high
+	spi_cur[s == SPI1] = 0;
+}
+
+/*
+ * describe a device: its chip select, SPIBR divider & SPI_MODEn
+ */
+void spi_dev_init(spi_dev *d, SPI_TypeDef *s, uint8_t cs, uint8_t br,
+	uint8_t mode)
+{
+	d->spi = s;
+	d->cs = cs;
+	d->br = br;
+	d->cr1 = 0x84;			// as spi_init()
+	d->cr2 = 0xc0 | mode;
 }
 
 /*
- * send a single byte with CS
+ * assert a device's CS, first switching the core to its clock & mode if
+ * another device used it last
  */
-void spi_tx_byte(SPI_TypeDef *s, uint8_t data)
+void spi_dev_select(spi_dev *d)
 {
-	spi_cs_low(s);
+	SPI_TypeDef *s = d->spi;
+	spi_dev **cur = &spi_cur[s == SPI1];
+	
+	if(*cur != d)
+	{
+		spi_idle_wait(s);
+		if(!*cur || ((*cur)->br != d->br))
+			s->SPIBR = d->br;
+		if(!*cur || ((*cur)->cr1 != d->cr1))
+			s->SPICR1 = d->cr1;
+		if(!*cur || ((*cur)->cr2 != d->cr2))
+			s->SPICR2 = d->cr2;
+		*cur = d;
+	}
+	
+	s->SPICSR = 0xff ^ (1<<d->cs);
+}
+
+/*
+ * release a device's CS once its last byte is out
+ */
+void spi_dev_release(spi_dev *d)
+{
+	spi_idle_wait(d->spi);
+	spi_cs_high(d->spi);
+}
+
+/*
+ * send a single byte to a device with its CS
+ */
+void spi_tx_byte(spi_dev *d, uint8_t data)
+{
+	SPI_TypeDef *s = d->spi;
+	
+	spi_dev_select(d);
 	
 	/* check for tx ready */
 	spi_tx_wait(s);
@@ -38,11 +90,13 @@ void spi_tx_byte(SPI_TypeDef *s, uint8_t data)
 }
 
 /*
- * send & receive a single byte with CS
+ * send & receive a single byte with a device's CS
  */
-uint8_t spi_txrx_byte(SPI_TypeDef *s, uint8_t data)
+uint8_t spi_txrx_byte(spi_dev *d, uint8_t data)
 {
-	spi_cs_low(s);
+	SPI_TypeDef *s = d->spi;
+	
+	spi_dev_select(d);
 	
 	/* check for tx ready */
 	spi_tx_wait(s);
@@ -98,4 +152,79 @@ void spi_receive(SPI_TypeDef *s, uint8_t *dst, uint16_t sz)
 		/* get read data */
 		*dst++ = s->SPIRXDR;
 	}
-}
\ No newline at end of file
+}
+
+/*
+ * start a dma transfer without CS. src == NULL sends 0 and dst == NULL
+ * discards received data. Buffers must be in SPRAM.
+ */
+void spi_dma_start(SPI_TypeDef *s, uint8_t *src, uint8_t *dst, uint16_t sz)
+{
+	uint32_t ctrl = SPIDMA_CTRL_START;
+	
+	if(s == SPI1)
+		ctrl |= SPIDMA_CTRL_SPI1;
+	
+	if(src)
+	{
+		SPIDMA->TXADDR = (uint32_t)src;
+		ctrl |= SPIDMA_CTRL_TXEN;
+	}
+	else
+		SPIDMA->FILL = 0;
+	
+	if(dst)
+	{
+		SPIDMA->RXADDR = (uint32_t)dst;
+		ctrl |= SPIDMA_CTRL_RXEN;
+	}
+	
+	SPIDMA->COUNT = sz;
+	SPIDMA->CTRL = ctrl;
+}
+
+/*
+ * check for dma transfer in progress
+ */
+uint8_t spi_dma_busy(void)
+{
+	return SPIDMA->STAT & SPIDMA_STAT_BUSY;
+}
+
+/*
+ * wait for dma transfer to complete
+ */
+void spi_dma_wait(void)
+{
+	while(spi_dma_busy());
+}
+
+/*
+ * send a buffer of data without CS using dma if possible
+ */
+void spi_dma_transmit(SPI_TypeDef *s, uint8_t *src, uint16_t sz)
+{
+	if(!spi_dma_ok(src))
+	{
+		spi_transmit(s, src, sz);
+		return;
+	}
+	
+	spi_dma_start(s, src, 0, sz);
+	spi_dma_wait();
+}
+
+/*
+ * receive a buffer of data without CS using dma if possible
+ */
+void spi_dma_receive(SPI_TypeDef *s, uint8_t *dst, uint16_t sz)
+{
+	if(!spi_dma_ok(dst))
+	{
+		spi_receive(s, dst, sz);
+		return;
+	}
+	
+	spi_dma_start(s, 0, dst, sz);
+	spi_dma_wait();
+}
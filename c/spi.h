@@ -11,15 +11,54 @@
 /* some common operation macros */
 #define spi_tx_wait(s) while(!(((s)->SPISR)&0x10))
 #define spi_rx_wait(s) while(!(((s)->SPISR)&0x08))
-#define spi_cs_low(s) ((s)->SPICSR=0xfe)
+#define spi_idle_wait(s) while((((s)->SPISR)&0x90)!=0x10)
 #define spi_cs_high(s) ((s)->SPICSR=0xff)
 
+/* SPICR2 clock mode bits */
+#define SPI_CPHA 0x02
+#define SPI_CPOL 0x04
+#define SPI_MODE0 0
+#define SPI_MODE1 SPI_CPHA
+#define SPI_MODE2 SPI_CPOL
+#define SPI_MODE3 (SPI_CPOL|SPI_CPHA)
+
+/* one device on a shared SPI core */
+typedef struct
+{
+	SPI_TypeDef *spi;	// core the device hangs off
+	uint8_t cs;			// chip select 0-3
+	uint8_t br;			// SPIBR clock divider
+	uint8_t cr1;		// SPICR1
+	uint8_t cr2;		// SPICR2 with the device's clock mode
+} spi_dev;
+
+/* dma control bits */
+#define SPIDMA_CTRL_START 0x01
+#define SPIDMA_CTRL_TXEN 0x02
+#define SPIDMA_CTRL_RXEN 0x04
+#define SPIDMA_CTRL_IRQEN 0x08
+#define SPIDMA_CTRL_SPI1 0x10
+#define SPIDMA_STAT_BUSY 0x01
+#define SPIDMA_STAT_DONE 0x02
+
+/* dma can only reach buffers in SPRAM */
+#define spi_dma_ok(p) ((((uint32_t)(p))>>28)==1)
+
 /* spi functions */
 void spi_init(SPI_TypeDef *s);
-void spi_tx_byte(SPI_TypeDef *s, uint8_t data);
-uint8_t spi_txrx_byte(SPI_TypeDef *s, uint8_t data);
+void spi_dev_init(spi_dev *d, SPI_TypeDef *s, uint8_t cs, uint8_t br,
+	uint8_t mode);
+void spi_dev_select(spi_dev *d);
+void spi_dev_release(spi_dev *d);
+void spi_tx_byte(spi_dev *d, uint8_t data);
+uint8_t spi_txrx_byte(spi_dev *d, uint8_t data);
 void spi_transmit(SPI_TypeDef *s, uint8_t *src, uint16_t sz);
 void spi_receive(SPI_TypeDef *s, uint8_t *dst, uint16_t sz);
+void spi_dma_start(SPI_TypeDef *s, uint8_t *src, uint8_t *dst, uint16_t sz);
+uint8_t spi_dma_busy(void);
+void spi_dma_wait(void);
+void spi_dma_transmit(SPI_TypeDef *s, uint8_t *src, uint16_t sz);
+void spi_dma_receive(SPI_TypeDef *s, uint8_t *dst, uint16_t sz);
 
 #endif
 
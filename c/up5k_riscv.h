@@ -10,13 +10,34 @@
 
 // 32-bit parallel out
 #define gp_out (*(volatile uint32_t *)0x20000000)
+#define bench_mark (*(volatile uint32_t *)0x20000004)	// testbench only
 
-// 32-bit clock counter
-#define clkcnt_reg (*(volatile uint32_t *)0x50000000)
+// 64-bit free-running clock counter with compare channels
+#define TIMER_BASE 0x50000000
+
+typedef struct
+{
+	volatile uint32_t CNTLO;	// 0 - counter low, latches CNTHI
+	volatile uint32_t CNTHI;	// 1 - counter high at last CNTLO read
+	volatile uint32_t PEND;		// 2 - fired channels, write 1 to ack
+	volatile uint32_t ARM;		// 3 - armed channels, write 1 to arm
+	volatile uint32_t DISARM;	// 4 - write 1 to disarm
+	volatile uint32_t IE;		// 5 - channel interrupt enables
+	uint32_t reserved[2];
+	volatile uint32_t CMP[4];	// 8-11 - channel compare values
+} TIMER_TypeDef;
+
+#define TIMER ((TIMER_TypeDef *) TIMER_BASE)
+#define clkcnt_reg (TIMER->CNTLO)
 
 // ACIA serial
 #define acia_ctlstat (*(volatile uint8_t *)0x30000000)
 #define acia_data (*(volatile uint8_t *)0x30000004)
+#define acia_rxlvl (*(volatile uint8_t *)0x30000008)
+#define acia_txlvl (*(volatile uint8_t *)0x3000000C)
+#define acia_ovr (*(volatile uint8_t *)0x30000010)
+#define acia_divlo (*(volatile uint8_t *)0x30000014)
+#define acia_divhi (*(volatile uint8_t *)0x30000018)
 
 // SPI cores @ BUS_ADDR74 = 0b0000 and 0b0010
 #define SPI0_BASE 0x40000000
@@ -84,4 +105,87 @@ typedef struct
 #define I2C0 ((I2C_TypeDef *) I2C0_BASE)
 #define I2C1 ((I2C_TypeDef *) I2C1_BASE)
 
+// XIP flash window, cache counters & uncached stream window
+#define XIP_BASE 0x60000000
+#define XIP_STREAM 0x62000000
+#define xip_ctrl (*(volatile uint32_t *)0x61000000)
+#define xip_hits (*(volatile uint32_t *)0x61000004)
+#define xip_misses (*(volatile uint32_t *)0x61000008)
+#define xip_mode (*(volatile uint32_t *)0x6100000C)
+#define XIP_CTRL_FLUSH 0x01
+#define XIP_CTRL_CLEAR 0x02
+#define XIP_CTRL_CLOSE 0x04
+#define XIP_STAT_OPEN 0x02
+#define XIP_STAT_QUAD 0x04
+#define XIP_MODE(op,dummy,width) ((op)|((dummy)<<8)|((width)<<12))
+
+// place a function in XIP flash - must not be used on SPI0 flash drivers
+#define __xip __attribute__ ((section(".xip")))
+
+// SPI DMA engine
+#define SPIDMA_BASE 0x70000000
+
+typedef struct
+{
+	volatile uint32_t CTRL;		// 0 - start & config
+	volatile uint32_t STAT;		// 1 - busy & done
+	volatile uint32_t TXADDR;	// 2 - SPRAM tx buffer
+	volatile uint32_t RXADDR;	// 3 - SPRAM rx buffer
+	volatile uint32_t COUNT;	// 4 - bytes to transfer
+	volatile uint32_t FILL;		// 5 - tx byte when no tx buffer
+} SPIDMA_TypeDef;
+
+#define SPIDMA ((SPIDMA_TypeDef *) SPIDMA_BASE)
+
+// Wishbone bridge latency counters, above the SB cores
+#define WBB_BASE 0x40000400
+
+typedef struct
+{
+	volatile uint32_t CTRL;		// 0 - write clears counters
+	volatile uint32_t WRCNT;	// 1 - wishbone write cycles
+	volatile uint32_t WRCYC;	// 2 - clocks in write cycles
+	volatile uint32_t RDCNT;	// 3 - CPU reads
+	volatile uint32_t RDCYC;	// 4 - clocks CPU reads waited
+	volatile uint32_t STALL;	// 5 - clocks writes waited for queue space
+	volatile uint32_t MAXLAT;	// 6 - [31:16] max write, [15:0] max read
+	volatile uint32_t TMO;		// 7 - timed out cycles
+} WBB_TypeDef;
+
+#define WBB ((WBB_TypeDef *) WBB_BASE)
+
+// Interrupt controller
+#define INTC_BASE 0x80000000
+
+typedef struct
+{
+	volatile uint32_t PEND;		// 0 - pending, write 1 to ack
+	volatile uint32_t ENABLE;	// 1 - source enables
+	volatile uint32_t RAW;		// 2 - source levels
+} INTC_TypeDef;
+
+#define INTC ((INTC_TypeDef *) INTC_BASE)
+
+// Fabric LCD SPI master - replaces SPI1 on the pins when built in
+#define LCD_BASE 0x90000000
+
+typedef struct
+{
+	volatile uint32_t CTRL;		// 0 - W: clock div, R: status
+	volatile uint32_t CMD;		// 1 - command byte, DC low
+	volatile uint32_t DAT8;		// 2 - data byte
+	volatile uint32_t DAT16;	// 3 - pixel, high byte first
+	volatile uint32_t PIX2;		// 4 - two pixels, low half first
+	volatile uint32_t RAW4;		// 5 - four bytes in memory order
+	volatile uint32_t FILL;		// 6 - [31:16] count (0 = 65536), [15:0] pixel
+	volatile uint32_t END;		// 7 - release CS
+} LCD_TypeDef;
+
+#define LCD ((LCD_TypeDef *) LCD_BASE)
+#define LCD_STAT_BUSY 0x01
+#define LCD_STAT_FULL 0x02
+#define LCD_STAT_CS 0x04
+#define LCD_STAT_LEVEL(s) ((s)>>16)
+#define LCD_FIFO_DEPTH 256
+
 #endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+// i2c_slave.v - behavioral I2C memory stand-in for simulation
+// 10-17-26 E. Brombaugh
+//
+// 256 bytes behind a pointer, like a small EEPROM: the first byte of a
+// write sets the pointer and the rest are stored from there, reads return
+// bytes from the pointer on. Other addresses are not acknowledged.
+//
+// Checks the master's end of a read: every byte but the last must be
+// ACKed and the last NACKed before the STOP or repeated START, and no
+// more bytes clocked after the NACK. errors counts the violations for
+// the testbench to report.
+
+`timescale 1ns/1ps
+`default_nettype none
+
+module i2c_slave(
+	input scl,				// I2C clock
+	inout sda				// I2C data, open drain
+);
+	parameter NAME = "i2c";
+	parameter ADDR = 7'h1A;
+
+	reg [7:0] mem[0:255];
+	reg [7:0] ptr, sr;
+	reg [3:0] bitn;			// SCL rises in this byte, 9 with the ack
+	reg active, adr_phase, first, rd, nacked, sda_lo;
+	integer nrise, nwr, nrd, writes, reads, errors;
+	integer i;
+
+	initial
+	begin
+		for(i=0;i<256;i=i+1)
+			mem[i] = 8'h00;
+		ptr = 8'h00;
+		sr = 8'h00;
+		bitn = 4'd0;
+		active = 1'b0;
+		adr_phase = 1'b0;
+		first = 1'b0;
+		rd = 1'b0;
+		nacked = 1'b0;
+		sda_lo = 1'b0;
+		nrise = 0;
+		nwr = 0;
+		nrd = 0;
+		writes = 0;
+		reads = 0;
+		errors = 0;
+	end
+
+	// a read must end in a NACK before the master lets go of the bus. The
+	// testbench calls this at the end too, since an ACKed last byte can
+	// leave SDA held low so the STOP never shows
+	task end_check;
+		if(active & rd & ~nacked)
+		begin
+			$display("%t: %s: last read byte was ACKed", $realtime, NAME);
+			errors = errors + 1;
+		end
+	endtask
+
+	// START or repeated START
+	always @(negedge sda)
+		if(scl)
+		begin
+			end_check;
+			if(active & (nwr | nrd))
+				$display("%t: %s: %0d written, %0d read", $realtime, NAME,
+					nwr, nrd);
+			active = 1'b1;
+			adr_phase = 1'b1;
+			rd = 1'b0;
+			nacked = 1'b0;
+			bitn = 4'd0;
+			nwr = 0;
+			nrd = 0;
+		end
+
+	// STOP
+	always @(posedge sda)
+		if(scl)
+		begin
+			end_check;
+			if(active & (nwr | nrd))
+				$display("%t: %s: %0d written, %0d read", $realtime, NAME,
+					nwr, nrd);
+			active = 1'b0;
+			sda_lo = 1'b0;
+		end
+
+	// sample
+	always @(posedge scl)
+		if(active)
+		begin
+			if(nacked)
+			begin
+				// one rise is the STOP or repeated START, more is a byte
+				nrise = nrise + 1;
+				if(nrise == 2)
+				begin
+					$display("%t: %s: clocked on after a NACK", $realtime, NAME);
+					errors = errors + 1;
+				end
+			end
+			else if(bitn < 4'd8)
+			begin
+				if(~rd)
+					sr = {sr[6:0],sda};
+			end
+			else if(rd & sda)
+			begin
+				nacked = 1'b1;
+				nrise = 0;
+			end
+			bitn = bitn + 4'd1;
+		end
+
+	// drive
+	always @(negedge scl)
+		if(active & ~nacked)
+		begin
+			if(bitn == 4'd8)
+			begin
+				if(rd)
+					sda_lo = 1'b0;
+				else if(adr_phase)
+				begin
+					// address, ACK only our own
+					adr_phase = 1'b0;
+					if(sr[7:1] == ADDR)
+					begin
+						sda_lo = 1'b1;
+						rd = sr[0];
+						first = ~sr[0];
+					end
+					else
+						active = 1'b0;
+				end
+				else
+				begin
+					// pointer then data
+					if(first)
+						ptr = sr;
+					else
+					begin
+						mem[ptr] = sr;
+						ptr = ptr + 8'd1;
+						nwr = nwr + 1;
+						writes = writes + 1;
+					end
+					first = 1'b0;
+					sda_lo = 1'b1;
+				end
+			end
+			else if(bitn == 4'd9)
+			begin
+				bitn = 4'd0;
+				sda_lo = 1'b0;
+				if(rd)
+				begin
+					sr = mem[ptr];
+					ptr = ptr + 8'd1;
+					nrd = nrd + 1;
+					reads = reads + 1;
+					sda_lo = ~sr[7];
+				end
+			end
+			else if(rd)
+				sda_lo = ~sr[4'd7 - bitn];
+		end
+
+	assign sda = sda_lo ? 1'b0 : 1'bz;
+endmodule
@@ -0,0 +1,535 @@
+// ice40_cells.v - behavioral iCE40 UP5k primitives for simulation
+// 10-17-26 E. Brombaugh
+//
+// Compiled by icarus ahead of the yosys cell library, whose SB_SPI and
+// SB_I2C are empty shells that never drive SBACKO - without these every
+// SB register access would end in the bus timeout. Verilator uses them in
+// place of the library.
+//
+// Only what system.v uses, and only as far as the firmware uses it:
+//
+// SB_IO         - PIN_TYPE 6'b101001, tri-state output with plain input
+// SB_SPRAM256KA - 16k x 16 with nibble write masks
+// SB_SPI        - master mode with manual chip selects. SCK runs at
+//                 clk / (2 * ((SPIBR + 2) / 2)) - close to the part's
+//                 clk / (SPIBR + 1) - with CPOL/CPHA/LSBF from SPICR2.
+//                 SPISR, SPIIRQ and SPIIRQEN work as on the part; SPICR0
+//                 delays and slave mode are not modelled.
+// SB_I2C        - master with the STA/STO/WR/RD/ACK commands. A quarter
+//                 SCL period is {I2CBRMSB,I2CBRLSB} clocks. TRRDY, RARC
+//                 and SRW are valid after each byte's acknowledge slot,
+//                 with SCL held low until the next command. RD receives
+//                 bytes back to back until one goes out with a NACK, set
+//                 by the ACK bit of the last command written, so
+//                 RD|ACK must be issued while the last byte is on the
+//                 bus. Slave mode, clock stretching and general call are
+//                 not modelled.
+//
+// SB cores answer the Wishbone strobe on the following clock and drive
+// SBDATO/SBACKO only then, since wb_bus.v ORs all the cores together.
+
+`default_nettype none
+
+module SB_IO(
+	inout PACKAGE_PIN,
+	input LATCH_INPUT_VALUE,
+	input CLOCK_ENABLE,
+	input INPUT_CLK,
+	input OUTPUT_CLK,
+	input OUTPUT_ENABLE,
+	input D_OUT_0,
+	input D_OUT_1,
+	output D_IN_0,
+	output D_IN_1
+);
+	parameter [5:0] PIN_TYPE = 6'b000000;
+	parameter [0:0] PULLUP = 1'b0;
+	parameter [0:0] NEG_TRIGGER = 1'b0;
+	parameter IO_STANDARD = "SB_LVCMOS";
+
+	assign PACKAGE_PIN = OUTPUT_ENABLE ? D_OUT_0 : 1'bz;
+	assign D_IN_0 = PACKAGE_PIN;
+	assign D_IN_1 = 1'b0;
+
+	generate
+		if(PULLUP)
+			pullup(PACKAGE_PIN);
+	endgenerate
+endmodule
+
+module SB_SPRAM256KA(
+	input [13:0] ADDRESS,
+	input [15:0] DATAIN,
+	input [3:0] MASKWREN,
+	input WREN,
+	input CHIPSELECT,
+	input CLOCK,
+	input STANDBY,
+	input SLEEP,
+	input POWEROFF,
+	output reg [15:0] DATAOUT
+);
+	reg [15:0] mem[0:16383];
+
+	always @(posedge CLOCK)
+		if(CHIPSELECT & ~STANDBY & ~SLEEP & POWEROFF)
+		begin
+			if(WREN)
+			begin
+				if(MASKWREN[0])
+					mem[ADDRESS][3:0] <= DATAIN[3:0];
+				if(MASKWREN[1])
+					mem[ADDRESS][7:4] <= DATAIN[7:4];
+				if(MASKWREN[2])
+					mem[ADDRESS][11:8] <= DATAIN[11:8];
+				if(MASKWREN[3])
+					mem[ADDRESS][15:12] <= DATAIN[15:12];
+			end
+			else
+				DATAOUT <= mem[ADDRESS];
+		end
+endmodule
+
+module SB_SPI(
+	input SBCLKI,
+	input SBRWI,
+	input SBSTBI,
+	input SBADRI7, SBADRI6, SBADRI5, SBADRI4,
+	input SBADRI3, SBADRI2, SBADRI1, SBADRI0,
+	input SBDATI7, SBDATI6, SBDATI5, SBDATI4,
+	input SBDATI3, SBDATI2, SBDATI1, SBDATI0,
+	input MI,
+	input SI,
+	input SCKI,
+	input SCSNI,
+	output SBDATO7, SBDATO6, SBDATO5, SBDATO4,
+	output SBDATO3, SBDATO2, SBDATO1, SBDATO0,
+	output SBACKO,
+	output SPIIRQ,
+	output SPIWKUP,
+	output SO,
+	output SOE,
+	output MO,
+	output MOE,
+	output SCKO,
+	output SCKOE,
+	output MCSNO3, MCSNO2, MCSNO1, MCSNO0,
+	output MCSNOE3, MCSNOE2, MCSNOE1, MCSNOE0
+);
+	parameter BUS_ADDR74 = "0b0000";
+	localparam [3:0] BASE = (BUS_ADDR74 == "0b0000") ? 4'h0 :
+		(BUS_ADDR74 == "0b0001") ? 4'h1 :
+		(BUS_ADDR74 == "0b0010") ? 4'h2 : 4'h3;
+
+	wire [7:0] adr = {SBADRI7,SBADRI6,SBADRI5,SBADRI4,
+		SBADRI3,SBADRI2,SBADRI1,SBADRI0};
+	wire [7:0] dat = {SBDATI7,SBDATI6,SBDATI5,SBDATI4,
+		SBDATI3,SBDATI2,SBDATI1,SBDATI0};
+
+	// registers
+	reg [7:0] cr1, cr2, br, csr, irqen, irqf, txdr, rxdr, rdo;
+	reg tx_full, rrdy, roe, ack;
+	wire spe = cr1[7];
+	wire mstr = cr2[7];
+	wire cpol = cr2[2];
+	wire cpha = cr2[1];
+	wire lsbf = cr2[0];
+
+	// shifter - 16 SCK edges per byte, even ones leading
+	reg tip, sck;
+	reg [7:0] so, si;
+	reg [4:0] edges;			// edges left in the byte
+	reg [5:0] cnt;
+	wire [5:0] half = (br[5:0] + 6'd2) >> 1;
+	wire [3:0] e = 4'd0 - edges[3:0];	// this edge, 0-15
+	wire smp = (e[0] == cpha);
+	wire [7:0] si_nxt = lsbf ? {MI,si[7:1]} : {si[6:0],MI};
+	wire step = tip & ~|cnt;
+	wire start = ~tip & tx_full & spe & mstr;
+	wire [7:0] sr = {tip,tip,1'b0,~tx_full,rrdy,1'b0,roe,1'b0};
+
+	wire sel = SBSTBI & (adr[7:4] == BASE) & ~ack;
+	always @(posedge SBCLKI)
+	begin
+		ack <= sel;
+		rdo <= 8'h00;
+
+		if(start)
+		begin
+			tip <= 1'b1;
+			tx_full <= 1'b0;
+			irqf[4] <= 1'b1;
+			so <= txdr;
+			edges <= 5'd16;
+			cnt <= half - 6'd1;
+		end
+		else if(tip)
+		begin
+			cnt <= cnt - 6'd1;
+			if(step)
+			begin
+				cnt <= half - 6'd1;
+				sck <= ~sck;
+				edges <= edges - 5'd1;
+				if(smp)
+					si <= si_nxt;
+				else if(~cpha | (e != 4'd0))
+					so <= lsbf ? {1'b0,so[7:1]} : {so[6:0],1'b0};
+
+				if(edges == 5'd1)
+				begin
+					// byte done
+					tip <= 1'b0;
+					rxdr <= smp ? si_nxt : si;
+					roe <= roe | rrdy;
+					rrdy <= 1'b1;
+					irqf[3] <= 1'b1;
+				end
+			end
+		end
+
+		if(sel)
+		begin
+			if(SBRWI)
+				case(adr[3:0])
+					4'h6: irqf <= irqf & ~dat;
+					4'h7: irqen <= dat;
+					4'h9: cr1 <= dat;
+					4'hA:
+					begin
+						cr2 <= dat;
+						sck <= dat[2];
+					end
+					4'hB: br <= dat;
+					4'hD:
+					begin
+						txdr <= dat;
+						tx_full <= 1'b1;
+					end
+					4'hF: csr <= dat;
+					default: ;
+				endcase
+			else
+				case(adr[3:0])
+					4'h6: rdo <= irqf;
+					4'h7: rdo <= irqen;
+					4'h9: rdo <= cr1;
+					4'hA: rdo <= cr2;
+					4'hB: rdo <= br;
+					4'hC:
+					begin
+						rdo <= sr;
+						roe <= 1'b0;
+					end
+					4'hE:
+					begin
+						rdo <= rxdr;
+						rrdy <= 1'b0;
+					end
+					4'hF: rdo <= csr;
+					default: ;
+				endcase
+		end
+	end
+
+	initial
+	begin
+		cr1 = 8'h00;
+		cr2 = 8'h00;
+		br = 8'h00;
+		csr = 8'hff;
+		irqen = 8'h00;
+		irqf = 8'h00;
+		tx_full = 1'b0;
+		rrdy = 1'b0;
+		roe = 1'b0;
+		ack = 1'b0;
+		tip = 1'b0;
+		sck = 1'b0;
+	end
+
+	assign {SBDATO7,SBDATO6,SBDATO5,SBDATO4,
+		SBDATO3,SBDATO2,SBDATO1,SBDATO0} = ack ? rdo : 8'h00;
+	assign SBACKO = ack;
+	assign SPIIRQ = |(irqf & irqen);
+	assign SPIWKUP = 1'b0;
+	assign SO = 1'b0;
+	assign SOE = 1'b0;
+	assign MO = lsbf ? so[0] : so[7];
+	assign MOE = spe & mstr;
+	assign SCKO = sck;
+	assign SCKOE = spe & mstr;
+	assign {MCSNO3,MCSNO2,MCSNO1,MCSNO0} = csr[3:0];
+	assign {MCSNOE3,MCSNOE2,MCSNOE1,MCSNOE0} = {4{spe & mstr}};
+endmodule
+
+module SB_I2C(
+	input SBCLKI,
+	input SBRWI,
+	input SBSTBI,
+	input SBADRI7, SBADRI6, SBADRI5, SBADRI4,
+	input SBADRI3, SBADRI2, SBADRI1, SBADRI0,
+	input SBDATI7, SBDATI6, SBDATI5, SBDATI4,
+	input SBDATI3, SBDATI2, SBDATI1, SBDATI0,
+	input SCLI,
+	input SDAI,
+	output SBDATO7, SBDATO6, SBDATO5, SBDATO4,
+	output SBDATO3, SBDATO2, SBDATO1, SBDATO0,
+	output SBACKO,
+	output I2CIRQ,
+	output I2CWKUP,
+	output SCLO,
+	output SCLOE,
+	output SDAO,
+	output SDAOE
+);
+	parameter BUS_ADDR74 = "0b0001";
+	localparam [3:0] BASE = (BUS_ADDR74 == "0b0000") ? 4'h0 :
+		(BUS_ADDR74 == "0b0001") ? 4'h1 :
+		(BUS_ADDR74 == "0b0010") ? 4'h2 : 4'h3;
+
+	wire [7:0] adr = {SBADRI7,SBADRI6,SBADRI5,SBADRI4,
+		SBADRI3,SBADRI2,SBADRI1,SBADRI0};
+	wire [7:0] dat = {SBDATI7,SBDATI6,SBDATI5,SBDATI4,
+		SBDATI3,SBDATI2,SBDATI1,SBDATI0};
+
+	// registers
+	reg [7:0] cr1, cmdr, brlsb, irqen, irqf, txdr, rxdr, rdo;
+	reg [1:0] brmsb;
+	reg busy, tip, rarc, srw, arbl, trrdy, troe, ack;
+	wire en = cr1[7];
+	wire [7:0] sr = {tip,busy,rarc,srw,arbl,trrdy,troe,1'b0};
+
+	// bit engine - each SCL bit is four quarter periods of BR clocks
+	localparam ST_IDLE = 2'd0;	// bus idle or held with SCL low
+	localparam ST_START = 2'd1;	// (repeated) start then the address
+	localparam ST_BIT = 2'd2;	// 8 data bits & the acknowledge
+	localparam ST_STOP = 2'd3;
+	reg [1:0] st, q;
+	reg [9:0] qcnt;
+	reg [3:0] bitn;				// 0-7 data, 8 acknowledge
+	reg rd, adr_byte, nack, scl_lo, sda_lo;
+	reg [7:0] sh;
+	wire [9:0] qlen = {brmsb,brlsb};
+	wire qstep = (st != ST_IDLE) & ~|qcnt;
+	wire obit = (bitn == 4'd8) ? (rd ? nack : 1'b1) : (rd | sh[7]);
+
+	wire sel = SBSTBI & (adr[7:4] == BASE) & ~ack;
+	always @(posedge SBCLKI)
+	begin
+		ack <= sel;
+		rdo <= 8'h00;
+
+		if(qstep)
+		begin
+			qcnt <= (qlen > 10'd1) ? qlen - 10'd1 : 10'd0;
+			q <= q + 2'd1;
+			case(st)
+				ST_START:
+					case(q)
+						2'd0: sda_lo <= 1'b0;
+						2'd1: scl_lo <= 1'b0;
+						2'd2: sda_lo <= 1'b1;
+						2'd3:
+						begin
+							scl_lo <= 1'b1;
+							st <= ST_BIT;
+						end
+					endcase
+
+				ST_BIT:
+					case(q)
+						2'd0: sda_lo <= ~obit;
+						2'd1: scl_lo <= 1'b0;
+						2'd2:
+						begin
+							// lost the bus if a released SDA reads low
+							if(~rd & (bitn != 4'd8) & obit & ~SDAI)
+							begin
+								arbl <= 1'b1;
+								irqf[3] <= 1'b1;
+								busy <= 1'b0;
+								tip <= 1'b0;
+								sda_lo <= 1'b0;
+								st <= ST_IDLE;
+							end
+							else if(bitn == 4'd8)
+							begin
+								if(~rd)
+									rarc <= SDAI;
+							end
+							else
+								sh <= {sh[6:0],SDAI};
+						end
+						2'd3:
+						begin
+							scl_lo <= 1'b1;
+							bitn <= bitn + 4'd1;
+							if(bitn == 4'd8)
+							begin
+								// byte done, SCL held low until more to do
+								bitn <= 4'd0;
+								irqf[2] <= 1'b1;
+								trrdy <= 1'b1;
+								if(rd)
+								begin
+									rxdr <= sh;
+									troe <= troe | trrdy;
+									irqf[1] <= irqf[1] | trrdy;
+									if(nack)
+									begin
+										tip <= 1'b0;
+										st <= ST_IDLE;
+									end
+								end
+								else
+								begin
+									if(adr_byte)
+										srw <= ~rarc & sh[0];
+									rd <= adr_byte & ~rarc & sh[0];
+									adr_byte <= 1'b0;
+									tip <= 1'b0;
+									st <= ST_IDLE;
+								end
+							end
+						end
+					endcase
+
+				ST_STOP:
+					case(q)
+						2'd0: sda_lo <= 1'b1;
+						2'd1: scl_lo <= 1'b0;
+						2'd2: sda_lo <= 1'b0;
+						2'd3:
+						begin
+							busy <= 1'b0;
+							srw <= 1'b0;
+							st <= ST_IDLE;
+						end
+					endcase
+				default: ;
+			endcase
+		end
+		else if(st != ST_IDLE)
+			qcnt <= qcnt - 10'd1;
+
+		if(sel)
+		begin
+			if(SBRWI)
+				case(adr[3:0])
+					4'h6: irqf <= irqf & ~dat;
+					4'h7: irqen <= dat;
+					4'h8: cr1 <= dat;
+					4'h9:
+					begin
+						cmdr <= dat;
+						nack <= dat[3];
+						if(en & (st == ST_IDLE))
+						begin
+							qcnt <= 10'd0;
+							q <= 2'd0;
+							bitn <= 4'd0;
+							if(dat[7] | dat[4])
+							begin
+								// (repeated) start and/or write TXDR
+								st <= dat[7] ? ST_START : ST_BIT;
+								sh <= txdr;
+								rd <= 1'b0;
+								adr_byte <= dat[7];
+								busy <= 1'b1;
+								tip <= 1'b1;
+								trrdy <= 1'b0;
+								arbl <= 1'b0;
+							end
+							else if(dat[5] & rd)
+							begin
+								st <= ST_BIT;
+								tip <= 1'b1;
+								trrdy <= 1'b0;
+							end
+							else if(dat[6] & busy)
+								st <= ST_STOP;
+						end
+					end
+					4'hA: brlsb <= dat;
+					4'hB:
+					begin
+						// resets the core, releasing the bus
+						brmsb <= dat[1:0];
+						st <= ST_IDLE;
+						busy <= 1'b0;
+						tip <= 1'b0;
+						rd <= 1'b0;
+						srw <= 1'b0;
+						trrdy <= 1'b0;
+						scl_lo <= 1'b0;
+						sda_lo <= 1'b0;
+					end
+					4'hD:
+					begin
+						txdr <= dat;
+						if(~rd)
+							trrdy <= 1'b0;
+					end
+					default: ;
+				endcase
+			else
+				case(adr[3:0])
+					4'h6: rdo <= irqf;
+					4'h7: rdo <= irqen;
+					4'h8: rdo <= cr1;
+					4'h9: rdo <= cmdr;
+					4'hA: rdo <= brlsb;
+					4'hB: rdo <= {6'd0,brmsb};
+					4'hC: rdo <= sr;
+					4'hE:
+					begin
+						rdo <= rxdr;
+						trrdy <= 1'b0;
+						troe <= 1'b0;
+					end
+					default: ;
+				endcase
+		end
+	end
+
+	initial
+	begin
+		cr1 = 8'h00;
+		cmdr = 8'h00;
+		brlsb = 8'h00;
+		brmsb = 2'd0;
+		irqen = 8'h00;
+		irqf = 8'h00;
+		txdr = 8'h00;
+		rxdr = 8'h00;
+		busy = 1'b0;
+		tip = 1'b0;
+		rarc = 1'b0;
+		srw = 1'b0;
+		arbl = 1'b0;
+		trrdy = 1'b0;
+		troe = 1'b0;
+		ack = 1'b0;
+		st = ST_IDLE;
+		q = 2'd0;
+		qcnt = 10'd0;
+		bitn = 4'd0;
+		rd = 1'b0;
+		adr_byte = 1'b0;
+		nack = 1'b0;
+		scl_lo = 1'b0;
+		sda_lo = 1'b0;
+		sh = 8'h00;
+	end
+
+	assign {SBDATO7,SBDATO6,SBDATO5,SBDATO4,
+		SBDATO3,SBDATO2,SBDATO1,SBDATO0} = ack ? rdo : 8'h00;
+	assign SBACKO = ack;
+	assign I2CIRQ = |(irqf & irqen);
+	assign I2CWKUP = 1'b0;
+	assign SCLO = 1'b0;
+	assign SCLOE = scl_lo;
+	assign SDAO = 1'b0;
+	assign SDAOE = sda_lo;
+endmodule
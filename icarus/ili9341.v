@@ -0,0 +1,209 @@
+// ili9341.v - behavioral ILI9341 panel model with link statistics
+// 10-17-26 E. Brombaugh
+//
+// Write-only mode 0 model of the panel on SPI1. DC is sampled with the
+// last bit of each byte like the part. CASET, PASET, RAMWR, RAMWRC and
+// MADCTL (MV and BGR) are decoded into a 240x320 GRAM which dump() writes
+// out as a plain PPM in the orientation the firmware drew it.
+//
+// The counters are free-running so a testbench can difference them
+// around a region of interest:
+//  pixels     - RAMWR/RAMWRC pixels written
+//  cmd_bytes  - command bytes plus parameters of everything but RAMWR,
+//               i.e. link overhead
+//  data_bytes - pixel bytes
+//  windows    - CASET/PASET commands
+//  xfers      - CS low periods
+//  idle_ns    - time CS was low but SCLK stopped for longer than one bit
+//               between bytes
+
+`timescale 1ns/1ps
+`default_nettype none
+
+module ili9341(
+	input sclk,				// SPI clock
+	input mosi,				// master out
+	input cs,				// low-true chip select
+	input dc				// low for command bytes
+);
+	parameter VERBOSE = 0;	// print each transfer
+
+	reg [15:0] gram[0:240*320-1];
+	integer i;
+	initial
+		for(i=0;i<240*320;i=i+1)
+			gram[i] = 16'h0000;
+
+	// statistics
+	integer pixels, cmd_bytes, data_bytes, windows, xfers;
+	realtime idle_ns;
+	initial
+	begin
+		pixels = 0;
+		cmd_bytes = 0;
+		data_bytes = 0;
+		windows = 0;
+		xfers = 0;
+		idle_ns = 0;
+	end
+
+	// controller state
+	reg [7:0] sr, cmd, madctl, hi;
+	reg [2:0] bcnt;
+	integer narg;
+	reg [15:0] xs, xe, ys, ye, x, y;
+	initial
+	begin
+		bcnt = 3'd0;
+		cmd = 8'h00;
+		madctl = 8'h00;
+		narg = 0;
+		xs = 16'd0;
+		xe = 16'd239;
+		ys = 16'd0;
+		ye = 16'd319;
+		x = 16'd0;
+		y = 16'd0;
+	end
+
+	// one bit time from the last byte, for finding gaps
+	realtime t_rise, t_end, t_bit;
+	integer x_px, x_cmd;
+	initial
+		t_bit = 0;
+	always @(negedge cs)
+	begin
+		bcnt = 3'd0;
+		t_end = 0;
+		xfers = xfers + 1;
+		x_px = pixels;
+		x_cmd = cmd_bytes;
+	end
+
+	always @(posedge cs)
+		if(VERBOSE)
+			$display("%t: lcd: %0d pixels, %0d command bytes", $realtime,
+				pixels - x_px, cmd_bytes - x_cmd);
+
+	// write at the current address, MV swaps rows & columns
+	task pixel(input [15:0] c);
+		integer px, py;
+	begin
+		px = madctl[5] ? y : x;
+		py = madctl[5] ? x : y;
+		if((px < 240) && (py < 320))
+			gram[py*240+px] = c;
+		pixels = pixels + 1;
+		if(x >= xe)
+		begin
+			x = xs;
+			y = (y >= ye) ? ys : y + 16'd1;
+		end
+		else
+			x = x + 16'd1;
+	end
+	endtask
+
+	always @(posedge sclk)
+		if(!cs)
+		begin
+			if((bcnt == 3'd0) && (t_end > 0) && (t_bit > 0) &&
+				($realtime - t_end > 1.5*t_bit))
+				idle_ns = idle_ns + $realtime - t_end - t_bit;
+			else if(bcnt != 3'd0)
+				t_bit = $realtime - t_rise;
+			t_rise = $realtime;
+
+			sr = {sr[6:0],mosi};
+			bcnt = bcnt + 3'd1;
+			if(bcnt == 3'd0)
+			begin
+				t_end = $realtime;
+				if(!dc)
+				begin
+					cmd = sr;
+					narg = 0;
+					cmd_bytes = cmd_bytes + 1;
+					if((cmd == 8'h2A) || (cmd == 8'h2B))
+						windows = windows + 1;
+					if(cmd == 8'h2C)
+					begin
+						x = xs;
+						y = ys;
+					end
+				end
+				else
+				begin
+					case(cmd)
+						8'h2A:
+							case(narg)
+								0: xs[15:8] = sr;
+								1: xs[7:0] = sr;
+								2: xe[15:8] = sr;
+								3: xe[7:0] = sr;
+							endcase
+						8'h2B:
+							case(narg)
+								0: ys[15:8] = sr;
+								1: ys[7:0] = sr;
+								2: ye[15:8] = sr;
+								3: ye[7:0] = sr;
+							endcase
+						8'h36:
+							if(narg == 0)
+								madctl = sr;
+						8'h2C, 8'h3C:
+							if(narg[0])
+								pixel({hi,sr});
+							else
+								hi = sr;
+					endcase
+
+					if((cmd == 8'h2C) || (cmd == 8'h3C))
+						data_bytes = data_bytes + 1;
+					else
+						cmd_bytes = cmd_bytes + 1;
+					narg = narg + 1;
+				end
+			end
+		end
+
+	// totals since reset
+	task report;
+	begin
+		$display("lcd: %0d pixels, %0d data bytes, %0d overhead bytes",
+			pixels, data_bytes, cmd_bytes);
+		$display("lcd: %0d transfers, %0d windows, %0.0f ns SCLK idle",
+			xfers, windows, idle_ns);
+	end
+	endtask
+
+	// GRAM as a plain PPM, modules are wired BGR so the MADCTL bit set
+	// shows RGB565 as written
+	task dump(input [8*32-1:0] name);
+		integer fd, w, h, px, py, r, g, b, t;
+		reg [15:0] c;
+	begin
+		w = madctl[5] ? 320 : 240;
+		h = madctl[5] ? 240 : 320;
+		fd = $fopen(name, "w");
+		$fwrite(fd, "P3\n%0d %0d\n255\n", w, h);
+		for(py=0;py<h;py=py+1)
+			for(px=0;px<w;px=px+1)
+			begin
+				c = madctl[5] ? gram[px*240+py] : gram[py*240+px];
+				r = c[15:11] * 255 / 31;
+				g = c[10:5] * 255 / 63;
+				b = c[4:0] * 255 / 31;
+				if(!madctl[3])
+				begin
+					t = r;
+					r = b;
+					b = t;
+				end
+				$fwrite(fd, "%0d %0d %0d\n", r, g, b);
+			end
+		$fclose(fd);
+	end
+	endtask
+endmodule
@@ -0,0 +1,200 @@
+// spi_flash.v - behavioral SPI flash model for simulation
+// 10-17-26 E. Brombaugh
+//
+// Mode 0 model of a W25Q-style flash. Supports READ (0x03), fast read
+// (0x0B), dual output read (0x3B), SFDP read (0x5A), read status 1
+// (0x05), JEDEC ID (0x9F) and wakeup (0xAB). Dual output drives IO0 on
+// the MOSI pin. Contents are preloaded from an optional hex file at
+// LOAD_ADDR. The SFDP table advertises only the 1-1-2 read of the real
+// part's fast reads, since the model has no quad or 1-2-2 modes.
+//
+// Write enable (0x06) / disable (0x04), page program (0x02) and 4k, 32k
+// and 64k erase (0x20, 0x52, 0xD8) work like the part: they need WEL, a
+// program wraps within its 256-byte page and only clears bits, an erase
+// only starts if CS rises right after the address, and either one then
+// holds BUSY in status 1 for the time given by the T_ parameters. Other
+// commands are ignored while BUSY.
+
+`timescale 1ns/1ps
+`default_nettype none
+
+module spi_flash(
+	input sclk,				// SPI clock
+	inout mosi,				// data in, IO0 out for dual reads
+	output miso,			// data out
+	input cs				// low-true chip select
+);
+	parameter ADDR_W = 22;				// 4MB
+	parameter HEX = "flash.hex";		// initial contents
+	parameter LOAD_ADDR = 32'h100000;	// where to put them
+	parameter ID = 24'hEF4016;			// JEDEC ID
+	parameter T_PP = 20000;				// page program ns, scaled down
+	parameter T_SE = 100000;			// 4k sector erase ns
+	parameter T_BE32 = 200000;			// 32k block erase ns
+	parameter T_BE64 = 300000;			// 64k block erase ns
+
+	reg [7:0] mem[0:(1<<ADDR_W)-1];
+	reg [7:0] sfdp[0:255];
+	integer i, fd;
+	initial
+	begin
+		for(i=0;i<(1<<ADDR_W);i=i+1)
+			mem[i] = 8'hff;
+
+		// SFDP header, one parameter header, basic table at 0x80
+		for(i=0;i<256;i=i+1)
+			sfdp[i] = 8'hff;
+		{sfdp[3],sfdp[2],sfdp[1],sfdp[0]} = 32'h50444653;	// "SFDP"
+		{sfdp[7],sfdp[6],sfdp[5],sfdp[4]} = 32'hFF000100;	// rev 1.0, 1 header
+		{sfdp[11],sfdp[10],sfdp[9],sfdp[8]} = 32'h09010000;	// BFPT 1.0, 9 dwords
+		{sfdp[15],sfdp[14],sfdp[13],sfdp[12]} = 32'hFF000080;	// @ 0x80
+		{sfdp[131],sfdp[130],sfdp[129],sfdp[128]} = 32'hFF8120E5;	// 1-1-2 only
+		{sfdp[135],sfdp[134],sfdp[133],sfdp[132]} = (32'd8 << ADDR_W) - 1;
+		{sfdp[139],sfdp[138],sfdp[137],sfdp[136]} = 32'h00000000;	// no 1-4-4, 1-1-4
+		{sfdp[143],sfdp[142],sfdp[141],sfdp[140]} = 32'h00003B08;	// 1-1-2 0x3B, 8 dummy
+		fd = $fopen(HEX, "r");
+		if(fd)
+		begin
+			$fclose(fd);
+			$readmemh(HEX, mem, LOAD_ADDR);
+		end
+	end
+
+	// protocol state
+	reg [7:0] sr_in, cmd, sr_out;
+	reg [31:0] bits;
+	reg [23:0] addr;
+	reg drive, dual, wel, ok;
+	time busy_end;
+	initial
+	begin
+		wel = 1'b0;
+		busy_end = 0;
+	end
+	always @(negedge cs)
+	begin
+		bits = 0;
+		drive = 1'b0;
+		dual = 1'b0;
+		sr_out = 8'hff;
+	end
+
+	// sample on rising edge
+	always @(posedge sclk)
+		if(!cs)
+		begin
+			sr_in = {sr_in[6:0],mosi};
+			bits = bits + 1;
+
+			if(bits == 8)
+			begin
+				cmd = sr_in;
+				ok = wel;
+				if(($time < busy_end) && (cmd != 8'h05))
+					cmd = 8'hFF;
+			end
+			else if((bits > 8) && (bits <= 32))
+				addr = {addr[22:0],mosi};
+			else if((cmd == 8'h02) && ok && (bits[2:0] == 3'd0))
+			begin
+				// program clears bits, address wraps within the page
+				mem[addr[ADDR_W-1:0]] = mem[addr[ADDR_W-1:0]] & sr_in;
+				addr[7:0] = addr[7:0] + 8'd1;
+			end
+		end
+
+	// commands which act when CS rises
+	task erase(input [23:0] size, input integer t);
+		reg [23:0] a;
+	begin
+		if(ok && (bits == 32))
+		begin
+			a = addr & ~(size - 24'd1);
+			for(i=0;i<size;i=i+1)
+				mem[(a+i) & ((1<<ADDR_W)-1)] = 8'hff;
+			wel = 1'b0;
+			busy_end = $time + t;
+		end
+	end
+	endtask
+
+	always @(posedge cs)
+		case(cmd)
+			8'h06: if(bits == 8) wel = 1'b1;
+			8'h04: if(bits == 8) wel = 1'b0;
+			8'h02:
+				if(ok && (bits >= 40) && (bits[2:0] == 3'd0))
+				begin
+					wel = 1'b0;
+					busy_end = $time + T_PP;
+				end
+			8'h20: erase(24'h001000, T_SE);
+			8'h52: erase(24'h008000, T_BE32);
+			8'hD8: erase(24'h010000, T_BE64);
+		endcase
+
+	// shift on falling edge
+	always @(negedge sclk)
+		if(!cs)
+		begin
+			if((cmd == 8'h3B) && (bits >= 40))
+			begin
+				// two bits per clock, IO1 carries the odd bits
+				dual = 1'b1;
+				drive = 1'b1;
+				if(bits[1:0] == 2'd0)
+				begin
+					sr_out = mem[addr[ADDR_W-1:0]];
+					addr = addr + 24'd1;
+				end
+				else
+					sr_out = {sr_out[5:0],2'b11};
+			end
+			else if(bits[2:0] == 3'd0)
+			begin
+				// load next byte
+				drive = 1'b0;
+				case(cmd)
+					8'h03:
+						if(bits >= 32)
+						begin
+							sr_out = mem[addr[ADDR_W-1:0]];
+							addr = addr + 24'd1;
+							drive = 1'b1;
+						end
+					8'h0B:
+						if(bits >= 40)
+						begin
+							sr_out = mem[addr[ADDR_W-1:0]];
+							addr = addr + 24'd1;
+							drive = 1'b1;
+						end
+					8'h5A:
+						if(bits >= 40)
+						begin
+							sr_out = sfdp[addr[7:0]];
+							addr = addr + 24'd1;
+							drive = 1'b1;
+						end
+					8'h05:
+						if(bits >= 8)
+						begin
+							// repeats for as long as CS is held
+							sr_out = {6'd0,wel,($time < busy_end)};
+							drive = 1'b1;
+						end
+					8'h9F:
+						if((bits >= 8) && (bits < 32))
+						begin
+							sr_out = ID >> (8*(3-bits/8));
+							drive = 1'b1;
+						end
+				endcase
+			end
+			else
+				sr_out = {sr_out[6:0],1'b1};
+		end
+
+	assign miso = (!cs && drive) ? sr_out[7] : 1'bz;
+	assign mosi = (!cs && drive && dual) ? sr_out[6] : 1'bz;
+endmodule
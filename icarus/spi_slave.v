@@ -0,0 +1,94 @@
+// spi_slave.v - behavioral SPI slave stand-in for simulation
+// 10-17-26 E. Brombaugh
+//
+// Mode 0 slave: samples MOSI on rising SCLK, shifts MISO on falling SCLK.
+// Returns an incrementing byte pattern and reports each byte received
+// and the byte count / timing of each CS-framed transfer.
+//
+// With CHECK set, byte n of each transfer must be ~n, as bench.c's DMA
+// region sends. checked and errors count the bytes compared and the
+// mismatches for the testbench to report.
+
+`timescale 1ns/1ps
+`default_nettype none
+
+module spi_slave(
+	input sclk,				// SPI clock
+	input mosi,				// master out
+	output miso,			// master in
+	input cs				// low-true chip select
+);
+	parameter NAME = "spi";
+	parameter VERBOSE = 0;
+	parameter CHECK = 0;
+
+	reg [7:0] rx_sr, tx_sr, tx_next;
+	reg [2:0] bcnt;
+	integer nbytes, checked, errors;
+	realtime t_start;
+
+	initial
+	begin
+		rx_sr = 8'h00;
+		tx_sr = 8'h00;
+		tx_next = 8'h00;
+		bcnt = 3'd0;
+		nbytes = 0;
+		checked = 0;
+		errors = 0;
+	end
+
+	// start of transfer
+	always @(negedge cs)
+	begin
+		bcnt = 3'd0;
+		nbytes = 0;
+		tx_sr = tx_next;
+		t_start = $realtime;
+	end
+
+	// end of transfer
+	always @(posedge cs)
+		if(nbytes)
+			$display("%t: %s: %0d bytes in %0.0f ns", $realtime, NAME,
+				nbytes, $realtime - t_start);
+
+	// receive
+	always @(posedge sclk)
+		if(!cs)
+		begin
+			rx_sr = {rx_sr[6:0],mosi};
+			bcnt = bcnt + 3'd1;
+			if(bcnt == 3'd0)
+			begin
+				nbytes = nbytes + 1;
+				if(VERBOSE)
+					$display("%t: %s: rx 0x%02X", $realtime, NAME, rx_sr);
+				if(CHECK)
+				begin
+					checked = checked + 1;
+					if(rx_sr != ~(nbytes[7:0] - 8'd1))
+					begin
+						if(!errors)
+							$display("%t: %s: byte %0d is 0x%02X, expected 0x%02X",
+								$realtime, NAME, nbytes - 1, rx_sr,
+								~(nbytes[7:0] - 8'd1));
+						errors = errors + 1;
+					end
+				end
+				tx_next = tx_next + 8'd1;
+			end
+		end
+
+	// transmit
+	always @(negedge sclk)
+		if(!cs)
+		begin
+			if(bcnt == 3'd0)
+				tx_sr = tx_next;
+			else
+				tx_sr = {tx_sr[6:0],1'b0};
+		end
+
+	assign miso = cs ? 1'bz : tx_sr[7];
+endmodule
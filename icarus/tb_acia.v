@@ -0,0 +1,198 @@
+// tb_acia.v - testbench for the ACIA baud divisor and receiver
+// 10-17-26 E. Brombaugh
+//
+// Loops the transmitter back to the receiver at rates from 115200 to
+// 3Mbaud and checks the data and the frame time against the divisor.
+// Then feeds the receiver from a model sender running a few percent off
+// rate to check the oversampled receiver's margin.
+
+`timescale 1ns/1ps
+`default_nettype none
+
+module tb_acia;
+	reg clk, rst, cs, we, ext, ext_tx;
+	reg [2:0] rs;
+	reg [7:0] din;
+	wire [7:0] dout;
+	wire tx, irq;
+
+	// 24MHz clock source
+	always
+		#21 clk = ~clk;
+
+	// unit under test, looped back unless the model sender is on
+	acia uut(
+		.clk(clk),
+		.rst(rst),
+		.cs(cs),
+		.we(we),
+		.rs(rs),
+		.rx(ext ? ext_tx : tx),
+		.din(din),
+		.dout(dout),
+		.tx(tx),
+		.irq(irq)
+	);
+
+	// bus cycles are two clocks like the CPU's
+	task wr(input [2:0] r, input [7:0] d);
+	begin
+		@(posedge clk) #1 cs = 1'b1; we = 1'b1; rs = r; din = d;
+		@(posedge clk);
+		@(posedge clk) #1 cs = 1'b0; we = 1'b0;
+	end
+	endtask
+
+	reg [7:0] q;
+	task rd(input [2:0] r);
+	begin
+		@(posedge clk) #1 cs = 1'b1; rs = r;
+		@(posedge clk);
+		@(posedge clk) #1 cs = 1'b0;
+		q = dout;
+	end
+	endtask
+
+	task set_div(input [15:0] d);
+	begin
+		wr(3'd5, d[7:0]);
+		wr(3'd6, d[15:8]);
+	end
+	endtask
+
+	integer errs;
+	task wait_rx(input integer n);
+	begin
+		q = 0;
+		while(q < n)
+			rd(3'd2);
+	end
+	endtask
+
+	task check_rx(input integer n, input [7:0] seed);
+		integer i;
+	begin
+		wait_rx(n);
+		for(i=0;i<n;i=i+1)
+		begin
+			rd(3'd1);
+			if(q !== seed + i*37)
+			begin
+				$display("byte %0d: got 0x%02X, expected 0x%02X", i, q,
+					seed + i*37);
+				errs = errs + 1;
+			end
+		end
+		rd(3'd0);
+		if(q[4])
+		begin
+			$display("framing error flagged");
+			errs = errs + 1;
+		end
+	end
+	endtask
+
+	// loop back 8 bytes, timing the frames from the first start bit
+	real t0, t1, exp;
+	task loop(input [15:0] d);
+		integer i;
+	begin
+		set_div(d);
+		rd(3'd5);
+		if(q !== d[7:0])
+		begin
+			$display("divisor readback 0x%02X", q);
+			errs = errs + 1;
+		end
+		t0 = $realtime;
+		for(i=0;i<8;i=i+1)
+			wr(3'd1, 8'h5A + i*37);
+		wait_rx(8);
+		rd(3'd0);
+		while(!q[2])
+			rd(3'd0);
+		t1 = $realtime;
+		exp = 80.0 * d / 16.0 * 42.0;
+		if((t1 - t0 < exp) || (t1 - t0 > exp * 1.01 + 500.0))
+		begin
+			$display("div %0d: 8 frames took %0.0fns, expected %0.0fns", d,
+				t1 - t0, exp);
+			errs = errs + 1;
+		end
+		check_rx(8, 8'h5A);
+	end
+	endtask
+
+	// model sender with a bit time off by a factor
+	task send(input [7:0] d, input real bit);
+		integer b;
+	begin
+		ext_tx = 1'b0;
+		#(bit);
+		for(b=0;b<8;b=b+1)
+		begin
+			ext_tx = d[b];
+			#(bit);
+		end
+		ext_tx = 1'b1;
+		#(bit);
+	end
+	endtask
+
+	task ext_test(input [15:0] d, input real f);
+		integer i;
+	begin
+		set_div(d);
+		ext = 1'b1;
+		for(i=0;i<8;i=i+1)
+			send(8'h11 + i*37, d / 16.0 * 42.0 * f);
+		check_rx(8, 8'h11);
+		ext = 1'b0;
+	end
+	endtask
+
+	initial
+	begin
+`ifndef NO_VCD
+		$dumpfile("tb_acia.vcd");
+		$dumpvars;
+`endif
+		clk = 1'b0;
+		rst = 1'b1;
+		cs = 1'b0;
+		we = 1'b0;
+		rs = 3'd0;
+		din = 8'h00;
+		ext = 1'b0;
+		ext_tx = 1'b1;
+		errs = 0;
+		#200 rst = 1'b0;
+
+		// reset rate
+		rd(3'd6);
+		if(q !== 8'h0D)
+		begin
+			$display("reset divisor high 0x%02X", q);
+			errs = errs + 1;
+		end
+
+		// 115200, 921600, 1.5M, 2M, 3M
+		loop(16'd3333);
+		loop(16'd417);
+		loop(16'd256);
+		loop(16'd192);
+		loop(16'd128);
+
+		// sender 3% fast and slow, 16x and 8x
+		ext_test(16'd417, 0.97);
+		ext_test(16'd417, 1.03);
+		ext_test(16'd128, 0.97);
+		ext_test(16'd128, 1.03);
+
+		if(errs)
+			$display("acia: FAIL (%0d errors)", errs);
+		else
+			$display("acia: PASS");
+		$finish;
+	end
+endmodule
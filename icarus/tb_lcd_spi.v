@@ -0,0 +1,226 @@
+// tb_lcd_spi.v - testbench for the fabric LCD SPI master
+// 10-17-26 E. Brombaugh
+//
+// Queues one of each entry type, checks the bytes and DC levels seen on
+// the wire, then times a fill to report throughput. Last, a FILL with a
+// count of 0 must send 65536 pixels in one CS frame.
+
+`timescale 1ns/1ps
+`default_nettype none
+
+module tb_lcd_spi;
+	reg clk, rst, cs, we;
+	reg [2:0] addr;
+	reg [31:0] din;
+	wire [31:0] dout;
+	wire spi_cs_n, spi_sclk, spi_mosi, spi_dc;
+
+	// 24MHz clock source
+	always
+		#21 clk = ~clk;
+
+	// unit under test
+	lcd_spi uut(
+		.clk(clk),
+		.rst(rst),
+		.cs(cs),
+		.we(we),
+		.addr(addr),
+		.din(din),
+		.dout(dout),
+		.spi_cs_n(spi_cs_n),
+		.spi_sclk(spi_sclk),
+		.spi_mosi(spi_mosi),
+		.spi_dc(spi_dc)
+	);
+
+	// receiver - DC is sampled with the last bit like the ILI9341
+	reg [7:0] sr;
+	reg [8:0] rx[0:1023];
+	reg chk_fill;
+	reg [15:0] fill_px;
+	integer nbits, nrx, frames, fill_n0, fill_bad;
+	initial
+	begin
+		nbits = 0;
+		nrx = 0;
+		frames = 0;
+		chk_fill = 1'b0;
+		fill_bad = 0;
+	end
+	always @(negedge spi_cs_n)
+	begin
+		nbits = 0;
+		frames = frames + 1;
+	end
+	always @(posedge spi_sclk)
+		if(!spi_cs_n)
+		begin
+			sr = {sr[6:0],spi_mosi};
+			nbits = nbits + 1;
+			if(nbits == 8)
+			begin
+				if(nrx < 1024)
+					rx[nrx] = {spi_dc,sr};
+				// long fills are checked as they go, high byte first
+				if(chk_fill && ({spi_dc,sr} !== {1'b1,
+					((nrx - fill_n0) & 1) ? fill_px[7:0] : fill_px[15:8]}))
+					fill_bad = fill_bad + 1;
+				nrx = nrx + 1;
+				nbits = 0;
+			end
+		end
+
+	// CPU-style register access - 2 clocks per cycle like system.v
+	task wr(input [2:0] a, input [31:0] d);
+	begin
+		@(posedge clk);
+		cs <= 1'b1;
+		we <= 1'b1;
+		addr <= a;
+		din <= d;
+		@(posedge clk);
+		@(posedge clk);
+		cs <= 1'b0;
+		we <= 1'b0;
+	end
+	endtask
+
+	task rd(input [2:0] a, output [31:0] d);
+	begin
+		@(posedge clk);
+		cs <= 1'b1;
+		addr <= a;
+		@(posedge clk);
+		@(posedge clk);
+		cs <= 1'b0;
+		d = dout;
+	end
+	endtask
+
+	task wait_idle;
+		reg [31:0] s;
+	begin
+		s = 32'd1;
+		while(s[0])
+			rd(3'd0, s);
+	end
+	endtask
+
+	// expected {dc, byte} sequence for the entries below
+	reg [8:0] exp[0:19];
+	initial
+	begin
+		exp[0] = 9'h02A;		// CMD
+		exp[1] = 9'h100;		// DAT8 x2
+		exp[2] = 9'h110;
+		exp[3] = 9'h112;		// DAT16
+		exp[4] = 9'h134;
+		exp[5] = 9'h156;		// PIX2
+		exp[6] = 9'h178;
+		exp[7] = 9'h1AB;
+		exp[8] = 9'h1CD;
+		exp[9] = 9'h111;		// RAW4
+		exp[10] = 9'h122;
+		exp[11] = 9'h133;
+		exp[12] = 9'h144;
+		exp[13] = 9'h1F8;		// FILL x3
+		exp[14] = 9'h11F;
+		exp[15] = 9'h1F8;
+		exp[16] = 9'h11F;
+		exp[17] = 9'h1F8;
+		exp[18] = 9'h11F;
+		exp[19] = 9'h02C;		// CMD after DAT
+	end
+
+	integer i, errs, t0;
+	initial
+	begin
+`ifndef NO_VCD
+		$dumpfile("tb_lcd_spi.vcd");
+		$dumpvars;
+`endif
+		clk = 1'b0;
+		rst = 1'b1;
+		cs = 1'b0;
+		we = 1'b0;
+		addr = 3'd0;
+		din = 32'd0;
+		errs = 0;
+		#100
+		rst = 1'b0;
+
+		// one of each
+		wr(3'd0, 32'd0);
+		wr(3'd1, 32'h2A);
+		wr(3'd2, 32'h00);
+		wr(3'd2, 32'h10);
+		wr(3'd3, 32'h1234);
+		wr(3'd4, 32'hABCD5678);
+		wr(3'd5, 32'h44332211);
+		wr(3'd6, 32'h0003F81F);
+		wr(3'd1, 32'h2C);
+		wr(3'd7, 32'd0);
+		wait_idle;
+		#100
+
+		if(nrx != 20)
+		begin
+			$display("got %0d bytes, expected 20", nrx);
+			errs = errs + 1;
+		end
+		for(i=0;i<20;i=i+1)
+			if(rx[i] !== exp[i])
+			begin
+				$display("byte %0d: got dc=%b 0x%02X, expected dc=%b 0x%02X",
+					i, rx[i][8], rx[i][7:0], exp[i][8], exp[i][7:0]);
+				errs = errs + 1;
+			end
+		if((frames != 1) || !spi_cs_n)
+		begin
+			$display("CS framing wrong: %0d frames, cs_n=%b", frames, spi_cs_n);
+			errs = errs + 1;
+		end
+
+		// fill throughput at the fastest clock
+		t0 = $time;
+		wr(3'd6, 32'd1000 << 16);
+		wr(3'd7, 32'd0);
+		wait_idle;
+		$display("1000 pixel fill: %0d clocks", ($time - t0) / 42);
+
+		// count 0 is 65536 pixels, all in one frame
+		#100
+		fill_px = 16'hA55A;
+		fill_n0 = nrx;
+		t0 = frames;
+		chk_fill = 1'b1;
+		wr(3'd6, {16'd0,fill_px});
+		wr(3'd7, 32'd0);
+		wait_idle;
+		#100
+		chk_fill = 1'b0;
+		if(nrx - fill_n0 != 131072)
+		begin
+			$display("count 0 fill: got %0d bytes, expected 131072",
+				nrx - fill_n0);
+			errs = errs + 1;
+		end
+		if(fill_bad)
+		begin
+			$display("count 0 fill: %0d bytes wrong", fill_bad);
+			errs = errs + 1;
+		end
+		if((frames - t0 != 1) || !spi_cs_n)
+		begin
+			$display("count 0 fill: %0d frames, cs_n=%b", frames - t0, spi_cs_n);
+			errs = errs + 1;
+		end
+
+		if(errs)
+			$display("lcd_spi: FAIL (%0d errors)", errs);
+		else
+			$display("lcd_spi: PASS");
+		$finish;
+	end
+endmodule
@@ -0,0 +1,198 @@
+// tb_spi_flash.v - testbench for the SPI flash model write path
+// 10-17-26 E. Brombaugh
+//
+// Drives the model the way flash.c does: page programs split at page
+// boundaries with a status poll after each, erases of each size, and a
+// read back of everything touched. Also checks that a program without
+// write enable and a page that overruns its boundary behave like the part.
+
+`timescale 1ns/1ps
+`default_nettype none
+
+module tb_spi_flash;
+	reg sclk, cs, mosi_o;
+	wire mosi, miso;
+	assign mosi = mosi_o;
+
+	// unit under test - small and empty
+	spi_flash #(
+		.ADDR_W(18),
+		.HEX("none")
+	)
+	uut(
+		.sclk(sclk),
+		.mosi(mosi),
+		.miso(miso),
+		.cs(cs)
+	);
+
+	// mode 0 byte transfer at 12MHz
+	task xfer(input [7:0] d, output [7:0] q);
+		integer b;
+	begin
+		for(b=7;b>=0;b=b-1)
+		begin
+			mosi_o = d[b];
+			#41 sclk = 1'b1;
+			q[b] = miso;
+			#41 sclk = 1'b0;
+		end
+	end
+	endtask
+
+	reg [7:0] q;
+	task header(input [7:0] cmd, input [23:0] a);
+	begin
+		xfer(cmd, q);
+		xfer(a[23:16], q);
+		xfer(a[15:8], q);
+		xfer(a[7:0], q);
+	end
+	endtask
+
+	task cmd1(input [7:0] cmd);
+	begin
+		#50 cs = 1'b0;
+		xfer(cmd, q);
+		#50 cs = 1'b1;
+	end
+	endtask
+
+	// held-CS status poll, returns clocks spent busy
+	integer polls;
+	task busy_wait;
+	begin
+		polls = 0;
+		#50 cs = 1'b0;
+		xfer(8'h05, q);
+		q = 8'h01;
+		while(q[0])
+		begin
+			xfer(8'h00, q);
+			polls = polls + 1;
+		end
+		#50 cs = 1'b1;
+	end
+	endtask
+
+	// program len bytes of pattern from a, split at pages like flash.c
+	task program(input [23:0] a, input integer len, input [7:0] seed);
+		integer n, sz;
+	begin
+		n = 0;
+		while(n < len)
+		begin
+			sz = 256 - ((a + n) & 255);
+			if(sz > len - n)
+				sz = len - n;
+			cmd1(8'h06);
+			#50 cs = 1'b0;
+			header(8'h02, a + n);
+			repeat(sz)
+			begin
+				xfer(seed + n, q);
+				n = n + 1;
+			end
+			#50 cs = 1'b1;
+			busy_wait;
+		end
+	end
+	endtask
+
+	task erase(input [7:0] cmd, input [23:0] a);
+	begin
+		cmd1(8'h06);
+		#50 cs = 1'b0;
+		header(cmd, a);
+		#50 cs = 1'b1;
+		busy_wait;
+	end
+	endtask
+
+	integer errs;
+	task check(input [23:0] a, input integer len, input [7:0] seed,
+		input ff);
+		integer n;
+		reg [7:0] e;
+	begin
+		#50 cs = 1'b0;
+		header(8'h03, a);
+		for(n=0;n<len;n=n+1)
+		begin
+			xfer(8'h00, q);
+			e = ff ? 8'hff : seed + n;
+			if(q !== e)
+			begin
+				if(errs < 10)
+					$display("0x%06X: got 0x%02X, expected 0x%02X", a + n, q, e);
+				errs = errs + 1;
+			end
+		end
+		#50 cs = 1'b1;
+	end
+	endtask
+
+	initial
+	begin
+`ifndef NO_VCD
+		$dumpfile("tb_spi_flash.vcd");
+		$dumpvars;
+`endif
+		sclk = 1'b0;
+		cs = 1'b1;
+		mosi_o = 1'b0;
+		errs = 0;
+		#100
+
+		// unaligned multi-page program reads back and takes time
+		program(24'h0100F0, 700, 8'h11);
+		if(polls < 2)
+		begin
+			$display("no busy time after program");
+			errs = errs + 1;
+		end
+		check(24'h0100F0, 700, 8'h11, 0);
+		check(24'h0100E0, 16, 8'h00, 1);
+		check(24'h0103AC, 16, 8'h00, 1);
+
+		// program without WEN does nothing
+		#50 cs = 1'b0;
+		header(8'h02, 24'h020000);
+		xfer(8'h00, q);
+		#50 cs = 1'b1;
+		check(24'h020000, 1, 8'h00, 1);
+
+		// a page overrun wraps to the start of the page
+		cmd1(8'h06);
+		#50 cs = 1'b0;
+		header(8'h02, 24'h0201FE);
+		xfer(8'hA0, q);
+		xfer(8'hA1, q);
+		xfer(8'hA2, q);
+		#50 cs = 1'b1;
+		busy_wait;
+		check(24'h0201FE, 2, 8'hA0, 0);
+		check(24'h020100, 1, 8'hA2, 0);
+		check(24'h020200, 1, 8'h00, 1);
+
+		// 4k erase clears its sector only
+		program(24'h021000, 16, 8'h40);
+		program(24'h022000, 16, 8'h50);
+		erase(8'h20, 24'h021010);
+		check(24'h021000, 16, 8'h00, 1);
+		check(24'h022000, 16, 8'h50, 0);
+
+		// 32k and 64k erases
+		erase(8'h52, 24'h020000);
+		check(24'h020100, 1, 8'h00, 1);
+		check(24'h022000, 16, 8'h00, 1);
+		erase(8'hD8, 24'h010000);
+		check(24'h0100F0, 700, 8'h00, 1);
+
+		if(errs)
+			$display("spi_flash: FAIL (%0d errors)", errs);
+		else
+			$display("spi_flash: PASS");
+		$finish;
+	end
+endmodule
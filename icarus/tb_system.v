@@ -4,13 +4,25 @@
 `timescale 1ns/1ps
 `default_nettype none
 
+// simulated time, override for longer firmware runs
+`ifndef SIM_NS
+`define SIM_NS 2000000
+`endif
+
 module tb_system;
+	// ROM/RAM look-ahead path in system.v
+	parameter LA_MEM = 1;
+	
     reg clk24;
     reg reset;
 	reg RX;
     wire TX;
 	wire spi0_mosi, spi0_miso, spi0_sclk, spi0_cs0;
+	wire spi1_mosi, spi1_miso, spi1_sclk, spi1_cs0;
+	wire spi0_cs1, spi0_cs2, spi0_cs3, spi1_cs1, spi1_cs2, spi1_cs3;
+	wire i2c0_sda, i2c0_scl;
 	wire [31:0] gp_out;
+	integer cycles, fetches, sb_acc, sb_cyc;
 	
     // 24MHz clock source
     always
@@ -20,8 +32,10 @@ module tb_system;
     initial
     begin
 `ifdef icarus
+`ifndef NO_VCD
   		$dumpfile("tb_system.vcd");
 		$dumpvars;
+`endif
 `endif
         
         // init regs
@@ -34,13 +48,193 @@ module tb_system;
         reset = 1'b0;
         
 `ifdef icarus
-        // stop after 1 sec
-		#2000000 $finish;
+        // stop after SIM_NS
+		#(`SIM_NS)
+		$display("");
+		$display("LA_MEM=%0d: %0d cycles, %0d fetches, CPI = %0.3f",
+			LA_MEM, cycles, fetches, cycles * 1.0 / fetches);
+		$display("SB bus: %0d accesses, %0d cycles, %0.2f cycles/access",
+			sb_acc, sb_cyc, sb_cyc * 1.0 / sb_acc);
+		ulcd.report;
+		ulcd.dump("tb_lcd.ppm");
+		$finish;
 `endif
     end
     
+`ifdef icarus
+	// serial monitor - prints what the firmware sends at the ACIA's rate
+	real bit_ns;
+	integer ser_b;
+	reg [7:0] ser_ch;
+	initial
+		forever
+		begin
+			@(negedge TX);
+			bit_ns = uut.uacia.baud_div * 42.0 / 16.0;
+			#(bit_ns * 1.5);
+			for(ser_b=0;ser_b<8;ser_b=ser_b+1)
+			begin
+				ser_ch[ser_b] = TX;
+				#(bit_ns);
+			end
+			$write("%c", ser_ch);
+		end
+`endif
+	
+    // CPI monitor - counts clocks per instruction fetch after reset
+	always @(posedge clk24)
+		if(reset)
+		begin
+			cycles = 0;
+			fetches = 0;
+			sb_acc = 0;
+			sb_cyc = 0;
+		end
+		else
+		begin
+			cycles = cycles + 1;
+			if(uut.mem_valid & uut.mem_ready & uut.mem_instr)
+				fetches = fetches + 1;
+			
+			// cost of SB register accesses seen by the CPU
+			if(uut.wbb_sel)
+			begin
+				sb_cyc = sb_cyc + 1;
+				if(uut.mem_ready)
+					sb_acc = sb_acc + 1;
+			end
+		end
+	
+`ifdef icarus
+	// benchmark monitor - decodes the firmware's bench.h markers written to
+	// 0x20000004 and reports clocks per region when it signals done
+	reg [8*16-1:0] bm_name[0:15];
+	integer bm_runs[0:15], bm_tot[0:15], bm_min[0:15], bm_max[0:15];
+	integer bm_t0[0:15], bm_f0[0:15], bm_fet[0:15];
+	integer bm_i, bm_d;
+	integer bm_chk[0:15], bm_bad[0:15], bm_nbad;
+	
+	// LCD link use per region from the panel model's counters
+	integer bm_px0[0:15], bm_cmd0[0:15], bm_px[0:15], bm_cmd[0:15];
+	integer bm_win0[0:15], bm_win[0:15];
+	realtime bm_idle0[0:15], bm_idle[0:15];
+	wire [31:0] bm_dat = uut.mem_wdata;
+	initial
+		for(bm_i=0;bm_i<16;bm_i=bm_i+1)
+		begin
+			bm_name[bm_i] = "";
+			bm_runs[bm_i] = 0;
+			bm_tot[bm_i] = 0;
+			bm_fet[bm_i] = 0;
+			bm_px[bm_i] = 0;
+			bm_cmd[bm_i] = 0;
+			bm_win[bm_i] = 0;
+			bm_idle[bm_i] = 0;
+			bm_chk[bm_i] = 0;
+			bm_bad[bm_i] = 0;
+		end
+	always @(posedge clk24)
+		if(~reset & uut.gpo_sel & uut.mem_ready & uut.mem_addr[2] &
+			|uut.mem_wstrb)
+			case(bm_dat[31:28])
+				4'h1:
+				begin
+					bm_i = bm_dat[11:8];
+					bm_t0[bm_i] = cycles;
+					bm_f0[bm_i] = fetches;
+					bm_px0[bm_i] = ulcd.pixels;
+					bm_cmd0[bm_i] = ulcd.cmd_bytes;
+					bm_win0[bm_i] = ulcd.windows;
+					bm_idle0[bm_i] = ulcd.idle_ns;
+				end
+				4'h2:
+				begin
+					bm_i = bm_dat[11:8];
+					bm_d = cycles - bm_t0[bm_i];
+					if(!bm_runs[bm_i] || (bm_d < bm_min[bm_i]))
+						bm_min[bm_i] = bm_d;
+					if(!bm_runs[bm_i] || (bm_d > bm_max[bm_i]))
+						bm_max[bm_i] = bm_d;
+					bm_runs[bm_i] = bm_runs[bm_i] + 1;
+					bm_tot[bm_i] = bm_tot[bm_i] + bm_d;
+					bm_fet[bm_i] = bm_fet[bm_i] + fetches - bm_f0[bm_i];
+					bm_px[bm_i] = bm_px[bm_i] + ulcd.pixels - bm_px0[bm_i];
+					bm_cmd[bm_i] = bm_cmd[bm_i] + ulcd.cmd_bytes - bm_cmd0[bm_i];
+					bm_win[bm_i] = bm_win[bm_i] + ulcd.windows - bm_win0[bm_i];
+					bm_idle[bm_i] = bm_idle[bm_i] + ulcd.idle_ns - bm_idle0[bm_i];
+				end
+				4'h3:
+					bm_name[bm_dat[11:8]] = {bm_name[bm_dat[11:8]],bm_dat[7:0]};
+				4'h4:
+				begin
+					$display("");
+					$display("bench: %16s %5s %9s %9s %9s %6s", "region", "runs",
+						"avg clks", "min", "max", "CPI");
+					for(bm_i=0;bm_i<16;bm_i=bm_i+1)
+						if(bm_runs[bm_i])
+							$display("bench: %16s %5d %9d %9d %9d %6.3f",
+								bm_name[bm_i], bm_runs[bm_i],
+								bm_tot[bm_i] / bm_runs[bm_i], bm_min[bm_i],
+								bm_max[bm_i], bm_tot[bm_i] * 1.0 / bm_fet[bm_i]);
+					
+					// pixels per us of region time, so CPU time counts too
+					$display("bench: %16s %7s %6s %8s %6s %6s %8s", "lcd",
+						"pixels", "bytes", "bytes/px", "win/px", "idle%", "Mpx/s");
+					for(bm_i=0;bm_i<16;bm_i=bm_i+1)
+						if(bm_px[bm_i] | bm_cmd[bm_i])
+							$display("bench: %16s %7d %6d %8.2f %6.2f %6.1f %8.3f",
+								bm_name[bm_i], bm_px[bm_i],
+								bm_cmd[bm_i] + 2*bm_px[bm_i],
+								(bm_cmd[bm_i] + 2.0*bm_px[bm_i]) /
+									(bm_px[bm_i] ? bm_px[bm_i] : 1),
+								bm_win[bm_i] * 0.5 / (bm_px[bm_i] ? bm_px[bm_i] : 1),
+								100.0 * bm_idle[bm_i] / (bm_tot[bm_i] * 42.0),
+								bm_px[bm_i] * 1000.0 / (bm_tot[bm_i] * 42.0));
+					// bench_check() results
+					bm_nbad = 0;
+					for(bm_i=0;bm_i<16;bm_i=bm_i+1)
+						if(bm_bad[bm_i])
+						begin
+							$display("bench: %16s FAILED %0d of %0d checks",
+								bm_name[bm_i], bm_bad[bm_i], bm_chk[bm_i]);
+							bm_nbad = bm_nbad + bm_bad[bm_i];
+						end
+					// bytes the DMA region's slave got wrong
+					if(udma.errors)
+					begin
+						$display("bench: %16s FAILED %0d of %0d bytes",
+							"spi1 cs1 slave", udma.errors, udma.checked);
+						bm_nbad = bm_nbad + udma.errors;
+					end
+					// I2C reads the master ended wrongly
+					ui2c.end_check;
+					if(ui2c.errors)
+					begin
+						$display("bench: %16s FAILED %0d bus checks",
+							"i2c0 slave", ui2c.errors);
+						bm_nbad = bm_nbad + ui2c.errors;
+					end
+					if(!bm_nbad)
+						$display("bench: all checks passed");
+					ulcd.report;
+					ulcd.dump("tb_lcd.ppm");
+					$finish;
+				end
+				4'h5:
+				begin
+					bm_i = bm_dat[11:8];
+					bm_chk[bm_i] = bm_chk[bm_i] + 1;
+					if(!bm_dat[0])
+						bm_bad[bm_i] = bm_bad[bm_i] + 1;
+				end
+			endcase
+`endif
+	
     // Unit under test
-    system uut(
+    system #(
+		.LA_MEM(LA_MEM)
+	)
+	uut(
         .clk24(clk24),     // 24MHz system clock
         .reset(reset),     // high-true reset
 	
@@ -51,7 +245,74 @@ module tb_system;
 		.spi0_miso(spi0_miso),
 		.spi0_sclk(spi0_sclk),
 		.spi0_cs0(spi0_cs0),
+		.spi0_cs1(spi0_cs1),
+		.spi0_cs2(spi0_cs2),
+		.spi0_cs3(spi0_cs3),
+	
+		.spi1_mosi(spi1_mosi),	// SPI port
+		.spi1_miso(spi1_miso),
+		.spi1_sclk(spi1_sclk),
+		.spi1_cs0(spi1_cs0),
+		.spi1_cs1(spi1_cs1),
+		.spi1_cs2(spi1_cs2),
+		.spi1_cs3(spi1_cs3),
+	
+		.i2c0_sda(i2c0_sda),	// I2C port
+		.i2c0_scl(i2c0_scl),
 	
 		.gp_out(gp_out)    // general purpose output
     );
+	
+	// board pullups on I2C0
+	pullup(i2c0_sda);
+	pullup(i2c0_scl);
+	
+	// flash on SPI0
+	spi_flash uflash(
+		.sclk(spi0_sclk),
+		.mosi(spi0_mosi),
+		.miso(spi0_miso),
+		.cs(spi0_cs0)
+	);
+	
+	// LCD on SPI1 with DC on gp_out[30]
+	ili9341 ulcd(
+		.sclk(spi1_sclk),
+		.mosi(spi1_mosi),
+		.cs(spi1_cs0),
+		.dc(gp_out[30])
+	);
+	
+	// stand-in SPI slave on SPI1 for checking DMA transfers
+	spi_slave #(
+		.NAME("spi1")
+	)
+	uspi1(
+		.sclk(spi1_sclk),
+		.mosi(spi1_mosi),
+		.miso(spi1_miso),
+		.cs(spi1_cs0)
+	);
+	
+	// bench.c's DMA region target, checks what it receives
+	spi_slave #(
+		.NAME("spi1 cs1"),
+		.CHECK(1)
+	)
+	udma(
+		.sclk(spi1_sclk),
+		.mosi(spi1_mosi),
+		.miso(spi1_miso),
+		.cs(spi1_cs1)
+	);
+	
+	// memory at 0x1A on I2C0 for main.c's writes and bench.c's checks
+	i2c_slave #(
+		.NAME("i2c0"),
+		.ADDR(7'h1A)
+	)
+	ui2c(
+		.scl(i2c0_scl),
+		.sda(i2c0_sda)
+	);
 endmodule
@@ -15,17 +15,27 @@ module up5k_riscv(
 			spi0_miso,
 			spi0_sclk,
 			spi0_cs0,
+	output	spi0_cs1,
+			spi0_cs2,
+			spi0_cs3,
 	
 	// SPI1 port on PMOD
 	inout	spi1_mosi,
 			spi1_miso,
 			spi1_sclk,
 			spi1_cs0,
+	output	spi1_cs1,
+			spi1_cs2,
+			spi1_cs3,
 	
 	// I2C0 port on PMOD
 	inout	i2c0_sda,
 			i2c0_scl,
 	
+	// I2C1 port
+	inout	i2c1_sda,
+			i2c1_scl,
+	
 	// GP Out for LCD
 	output lcd_nrst, lcd_dc,
 	
@@ -104,14 +114,22 @@ module up5k_riscv(
 		.spi0_miso(spi0_miso),
 		.spi0_sclk(spi0_sclk),
 		.spi0_cs0(spi0_cs0),
+		.spi0_cs1(spi0_cs1),
+		.spi0_cs2(spi0_cs2),
+		.spi0_cs3(spi0_cs3),
 	
 		.spi1_mosi(spi1_mosi),
 		.spi1_miso(spi1_miso),
 		.spi1_sclk(spi1_sclk),
 		.spi1_cs0(spi1_cs0),
+		.spi1_cs1(spi1_cs1),
+		.spi1_cs2(spi1_cs2),
+		.spi1_cs3(spi1_cs3),
 	
 		.i2c0_sda(i2c0_sda),
 		.i2c0_scl(i2c0_scl),
+		.i2c1_sda(i2c1_sda),
+		.i2c1_scl(i2c1_scl),
 	
 		.gp_out(gpio_o)
 	);
@@ -1,29 +1,45 @@
 // acia.v - strippped-down version of MC6850 ACIA with home-made TX/RX
 // 03-02-19 E. Brombaugh
+//
+// Registers (rs):
+//  0 control (w) / status (r)
+//  1 tx data (w) / rx data (r) - FIFO push / pop
+//  2 rx level (r) / rx threshold (w)
+//  3 tx level (r) / tx threshold (w)
+//  4 rx overrun count (r, saturating) / clear (w)
+//  5 baud divisor low byte (r/w)
+//  6 baud divisor high byte (r/w) - writing loads both bytes
+//
+// The divisor is clocks per bit in 12.4 fixed point, 16*clk/baud, so
+// 3333 gives 115200 from 24MHz and 128 (3Mbaud) is the smallest.
 
 module acia(
 	input clk,				// system clock
 	input rst,				// system reset
 	input cs,				// chip select
 	input we,				// write enable
-	input rs,				// register select
+	input [2:0] rs,			// register select
 	input rx,				// serial receive
 	input [7:0] din,		// data bus input
 	output reg [7:0] dout,	// data bus output
 	output tx,				// serial tx_start
 	output irq				// high-true interrupt request
 );
-	// hard-coded bit-rate
-	localparam sym_rate = 115200;
-    localparam clk_freq = 24000000;
-    localparam sym_cnt = clk_freq / sym_rate;
-	localparam SCW = $clog2(sym_cnt);
-	
-	wire [SCW-1:0] sym_cntr = sym_cnt;
-	
-	// generate tx_start signal on write to register 1
-	wire tx_start = cs & rs & we;
-	
+	// reset bit-rate
+	parameter sym_rate = 115200;
+	parameter clk_freq = 24000000;
+	localparam [15:0] DIV_RST = (16 * clk_freq + sym_rate / 2) / sym_rate;
+
+	// FIFO sizes - levels are reported in 8 bits so 7 is the max
+	parameter RX_AW = 7;
+	parameter TX_AW = 7;
+
+	// bus cycles last more than one clock so only act on the first
+	reg cs_d;
+	always @(posedge clk)
+		cs_d <= cs;
+	wire acc = cs & ~cs_d;
+
 	// load control register
 	reg [1:0] counter_divide_select, tx_start_control;
 	reg [2:0] word_select; // dummy
@@ -37,7 +53,7 @@ module acia(
 			tx_start_control <= 2'b00;
 			receive_interrupt_enable <= 1'b0;
 		end
-		else if(cs & ~rs & we)
+		else if(acc & (rs==3'd0) & we)
 			{
 				receive_interrupt_enable,
 				tx_start_control,
@@ -45,111 +61,161 @@ module acia(
 				counter_divide_select
 			} <= din;
 	end
-	
+
 	// acia reset generation
 	wire acia_rst = rst | (counter_divide_select == 2'b11);
-	
-	// load dout with either status or rx data
-	wire [7:0] rx_dat, status;
+
+	// baud divisor - kept over an acia reset, low byte waits for the high
+	reg [15:0] baud_div;
+	reg [7:0] div_lo;
 	always @(posedge clk)
-	begin
 		if(rst)
 		begin
-			dout <= 8'h00;
-		end
-		else
-		begin
-			if(cs & ~we)
-			begin
-				if(rs)
-					dout <= rx_dat;
-				else
-					dout <= status;
-			end
+			baud_div <= DIV_RST;
+			div_lo <= DIV_RST[7:0];
 		end
-	end
-	
-	// tx empty is cleared when tx_start starts, cleared when tx_busy deasserts
-	reg txe;
-	wire tx_busy;
-	reg prev_tx_busy;
+		else if(acc & we)
+			case(rs)
+				3'd5: div_lo <= din;
+				3'd6: baud_div <= ({din,div_lo} < 16'd128) ? 16'd128 : {din,div_lo};
+			endcase
+
+	// FIFO thresholds & overrun counter
+	reg [7:0] rx_thr, tx_thr, rx_ovr;
+	wire rx_stb, rx_full;
 	always @(posedge clk)
 	begin
-		if(rst)
+		if(acia_rst)
 		begin
-			txe <= 1'b1;
-			prev_tx_busy <= 1'b0;
+			rx_thr <= 8'd1;
+			tx_thr <= 8'd1 << (TX_AW-1);
+			rx_ovr <= 8'd0;
 		end
 		else
 		begin
-			prev_tx_busy <= tx_busy;
-			
-			if(tx_start)
-				txe <= 1'b0;
-			else if(prev_tx_busy & ~tx_busy)
-				txe <= 1'b1;
+			if(acc & we)
+				case(rs)
+					3'd2: rx_thr <= din;
+					3'd3: tx_thr <= din;
+				endcase
+
+			if(acc & we & (rs==3'd4))
+				rx_ovr <= 8'd0;
+			else if(rx_stb & rx_full & ~&rx_ovr)
+				rx_ovr <= rx_ovr + 8'd1;
 		end
 	end
-	
-	// rx full is set when rx_stb pulses, cleared when data reg read
-	wire rx_stb;
-	reg rxf;
+
+	// receive FIFO - pushed by receiver, popped by data reg read
+	wire [7:0] rx_dat, rx_q;
+	wire rx_empty;
+	wire [RX_AW:0] rx_level;
+	acia_fifo #(
+		.DW(8),
+		.AW(RX_AW)
+	)
+	rx_fifo(
+		.clk(clk),
+		.rst(acia_rst),
+		.wr(rx_stb),
+		.din(rx_dat),
+		.rd(acc & (rs==3'd1) & ~we),
+		.dout(rx_q),
+		.empty(rx_empty),
+		.full(rx_full),
+		.level(rx_level)
+	);
+
+	// transmit FIFO - pushed by data reg write, popped by transmitter
+	wire [7:0] tx_q;
+	wire tx_empty, tx_full, tx_busy;
+	wire [TX_AW:0] tx_level;
+	wire tx_start = ~tx_busy & ~tx_empty;
+	acia_fifo #(
+		.DW(8),
+		.AW(TX_AW)
+	)
+	tx_fifo(
+		.clk(clk),
+		.rst(acia_rst),
+		.wr(acc & (rs==3'd1) & we),
+		.din(din),
+		.rd(tx_start),
+		.dout(tx_q),
+		.empty(tx_empty),
+		.full(tx_full),
+		.level(tx_level)
+	);
+
+	// status flags
+	wire rxf = ~rx_empty;
+	wire txe = ~tx_full;
+	wire rx_thr_hit = (rx_level >= rx_thr);
+	wire tx_thr_hit = (tx_level < tx_thr);
+	wire tx_idle = tx_empty & ~tx_busy;
+
+	// load dout with status, rx data, levels or overrun count
+	wire [7:0] status;
 	always @(posedge clk)
 	begin
 		if(rst)
-			rxf <= 1'b0;
+		begin
+			dout <= 8'h00;
+		end
 		else
 		begin
-			if(rx_stb)
-				rxf <= 1'b1;
-			else if(cs & rs & ~we)
-				rxf <= 1'b0;
+			if(acc & ~we)
+				case(rs)
+					3'd0: dout <= status;
+					3'd1: dout <= rx_q;
+					3'd2: dout <= rx_level;
+					3'd3: dout <= tx_level;
+					3'd4: dout <= rx_ovr;
+					3'd5: dout <= baud_div[7:0];
+					3'd6: dout <= baud_div[15:8];
+					default: dout <= 8'h00;
+				endcase
 		end
 	end
-	
+
 	// assemble status byte
 	wire rx_err;
-	assign status = 
+	assign status =
 	{
-		irq,				// bit 7 = irq - forced inactive
-		1'b0,				// bit 6 = parity error - unused
-		rx_err,			    // bit 5 = overrun error - same as all errors
-		rx_err,			    // bit 4 = framing error - same as all errors
-		1'b0,				// bit 3 = /CTS - forced active
-		1'b0,				// bit 2 = /DCD - forced active
-		txe,				// bit 1 = tx_start empty
-		rxf					// bit 0 = receive full
+		irq,				// bit 7 = irq
+		rx_thr_hit,			// bit 6 = rx level >= threshold (was parity)
+		|rx_ovr,		    // bit 5 = overrun error - rx FIFO overflowed
+		rx_err,			    // bit 4 = framing error
+		tx_thr_hit,			// bit 3 = tx level < threshold (was /CTS)
+		tx_idle,			// bit 2 = tx FIFO & shifter empty (was /DCD)
+		txe,				// bit 1 = tx FIFO not full
+		rxf					// bit 0 = rx FIFO not empty
 	};
-	
+
 	// Async Receiver
-	acia_rx #(
-		.SCW(SCW),				// rate counter width
-		.sym_cnt(sym_cnt)		// rate count value
-	)
-	my_rx(
+	acia_rx my_rx(
 		.clk(clk),				// system clock
 		.rst(acia_rst),			// system reset
+		.div(baud_div),			// clocks per bit
 		.rx_serial(rx),		    // raw serial input
 		.rx_dat(rx_dat),        // received byte
 		.rx_stb(rx_stb),        // received data available
 		.rx_err(rx_err)         // received data error
 	);
-	
+
 	// Transmitter
-	acia_tx #(
-		.SCW(SCW),              // rate counter width
-		.sym_cnt(sym_cnt)       // rate count value
-	)
-	my_tx(
+	acia_tx my_tx(
 		.clk(clk),				// system clock
 		.rst(acia_rst),			// system reset
-		.tx_dat(din),           // transmit data byte
+		.div(baud_div),			// clocks per bit
+		.tx_dat(tx_q),          // transmit data byte
 		.tx_start(tx_start),    // trigger transmission
 		.tx_serial(tx),         // tx serial output
 		.tx_busy(tx_busy)       // tx is active (not ready)
 	);
 
 	// generate IRQ
-	assign irq = (rxf & receive_interrupt_enable) | ((tx_start_control==2'b01) & txe);
+	assign irq = (rx_thr_hit & receive_interrupt_enable) |
+		((tx_start_control==2'b01) & tx_thr_hit);
 
 endmodule
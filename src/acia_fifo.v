@@ -0,0 +1,62 @@
+// acia_fifo.v - synchronous show-ahead FIFO for the ACIA
+// 10-17-26 E. Brombaugh
+//
+// dout always presents the oldest entry, rd pops it. Small depths map to
+// logic, larger ones to a single EBR.
+
+`default_nettype none
+
+module acia_fifo(
+	input clk,				// system clock
+	input rst,				// system reset
+	input wr,				// push din
+	input [DW-1:0] din,		// write data
+	input rd,				// pop dout
+	output [DW-1:0] dout,	// oldest entry
+	output empty,			// no entries
+	output full,			// no space
+	output reg [AW:0] level	// entries in use
+);
+	parameter DW = 8;		// data width
+	parameter AW = 7;		// log2 of depth
+
+	reg [DW-1:0] mem[0:(1<<AW)-1];
+	reg [AW-1:0] wptr, rptr;
+	wire do_wr = wr & ~full;
+	wire do_rd = rd & ~empty;
+	wire [AW-1:0] rptr_nxt = rptr + {{AW-1{1'b0}},do_rd};
+
+	// memory with bypass when writing the entry about to be presented
+	reg [DW-1:0] rd_q, din_q;
+	reg byp;
+	always @(posedge clk)
+	begin
+		if(do_wr)
+			mem[wptr] <= din;
+		rd_q <= mem[rptr_nxt];
+		din_q <= din;
+		byp <= do_wr && (wptr == rptr_nxt);
+	end
+	assign dout = byp ? din_q : rd_q;
+
+	// pointers & level
+	always @(posedge clk)
+		if(rst)
+		begin
+			wptr <= {AW{1'b0}};
+			rptr <= {AW{1'b0}};
+			level <= {AW+1{1'b0}};
+		end
+		else
+		begin
+			if(do_wr)
+				wptr <= wptr + 1;
+			if(do_rd)
+				rptr <= rptr_nxt;
+			level <= level + {{AW{1'b0}},do_wr} - {{AW{1'b0}},do_rd};
+		end
+
+	assign empty = ~|level;
+	assign full = level[AW];
+
+endmodule
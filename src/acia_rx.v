@@ -1,53 +1,57 @@
 // acia_rx.v - asynchronous serial receive submodule
 // 06-02-19 E. Brombaugh
+//
+// Bit timing comes from a fractional divider: div is clocks per bit in
+// 12.4 fixed point and a phase accumulator makes 16 ticks per bit (8 when
+// a bit is under 16 clocks). The start edge restarts the ticks and each
+// bit is a majority vote of the three ticks around its centre.
+
+`default_nettype none
 
 module acia_rx(
 	input clk,				  // system clock
 	input rst,				  // system reset
+	input [15:0] div,		  // clocks per bit, 12.4 fixed point
 	input rx_serial,		  // raw serial input
 	output reg [7:0] rx_dat,  // received byte
 	output reg rx_stb,        // received data available
 	output reg rx_err         // received data error
 );
-	// sym rate counter for 115200bps @ 16MHz clk
-    parameter SCW = 8;
-	parameter sym_cnt = 139;
-	
-	// input sync & deglitch
-	reg [7:0] in_pipe;
-	reg in_state;
-	wire all_zero = ~|in_pipe;
-	wire all_one = &in_pipe;
+	// input sync
+	reg [2:0] in_pipe;
 	always @(posedge clk)
 		if(rst)
-		begin
-			// assume RX input idle at start
-			in_pipe <= 8'hff;
-			in_state <= 1'b1;
-		end
+			in_pipe <= 3'b111;	// assume RX input idle at start
 		else
-		begin
-			// shift in a bit
-			in_pipe <= {in_pipe[6:0],rx_serial};
-	
-			// update state
-			if(in_state && all_zero)
-				in_state <= 1'b0;
-			else if(!in_state && all_one)
-				in_state <= 1'b1;
-		end
+			in_pipe <= {in_pipe[1:0],rx_serial};
+	wire in_state = in_pipe[2];
+
+	// oversampling ticks - 16x, or 8x above 1/16 of the clock. Ticks
+	// start a clock after the edge is seen, worth most of a tick at 8x,
+	// so the vote window is moved one tick earlier there.
+	wire os8 = ~|div[15:8];
+	wire [3:0] ph_last = os8 ? 4'd7 : 4'd15;
+	wire [3:0] ph_mid = os8 ? 4'd3 : 4'd8;
+	reg [15:0] rx_acc;
+	wire [16:0] rx_nxt = rx_acc + (os8 ? 16'd128 : 16'd256);
+	wire tick = (rx_nxt >= {1'b0,div});
 
 	// receive machine
 	reg [8:0] rx_sr;
 	reg [3:0] rx_bcnt;
-	reg [SCW-1:0] rx_rcnt;
+	reg [3:0] rx_ph;
+	reg [2:0] rx_vote;
 	reg rx_busy;
+	wire [2:0] vote = {rx_vote[1:0],in_state};
+	wire bit_val = (vote[0] & vote[1]) | (vote[0] & vote[2]) | (vote[1] & vote[2]);
 	always @(posedge clk)
 		if(rst)
 		begin
 			rx_busy <= 1'b0;
 			rx_stb <= 1'b0;
 			rx_err <= 1'b0;
+			rx_acc <= 16'd0;
+			rx_ph <= 4'd0;
 		end
 		else
 		begin
@@ -55,9 +59,10 @@ module acia_rx(
 			begin
 				if(!in_state)
 				begin
-					// found start bit - wait 1/2 bit to sample
+					// found start bit - restart the ticks from the edge
 					rx_bcnt <= 4'h9;
-					rx_rcnt <= sym_cnt/2;
+					rx_acc <= 16'd0;
+					rx_ph <= 4'd0;
 					rx_busy <= 1'b1;
 				end
 				
@@ -66,31 +71,41 @@ module acia_rx(
 			end
 			else
 			begin
-				if(~|rx_rcnt)
+				rx_acc <= tick ? rx_nxt[15:0] - div : rx_nxt[15:0];
+				if(tick)
 				begin
-					// sample data and restart for next bit
-					rx_sr <= {in_state,rx_sr[8:1]};
-					rx_rcnt <= sym_cnt;
-					rx_bcnt <= rx_bcnt - 1;
+					rx_ph <= (rx_ph == ph_last) ? 4'd0 : rx_ph + 4'd1;
+					
+					// collect the samples around the centre
+					if((rx_ph >= ph_mid - 4'd2) && (rx_ph <= ph_mid))
+						rx_vote <= vote;
 					
-					if(~|rx_bcnt)
+					if(rx_ph == ph_mid)
 					begin
-						// final bit - check for err and finish
-						rx_dat <= rx_sr[8:1];
-						rx_busy <= 1'b0;
-						if(in_state && ~rx_sr[0])
+						// decide the bit
+						rx_sr <= {bit_val,rx_sr[8:1]};
+						rx_bcnt <= rx_bcnt - 1;
+						
+						if((rx_bcnt == 4'h9) && bit_val)
+							// start bit was a glitch
+							rx_busy <= 1'b0;
+						else if(~|rx_bcnt)
 						begin
-							// framing OK
-							rx_err <= 1'b0;
-							rx_stb <= 1'b1;
+							// final bit - check for err and finish
+							rx_dat <= rx_sr[8:1];
+							rx_busy <= 1'b0;
+							if(bit_val && ~rx_sr[0])
+							begin
+								// framing OK
+								rx_err <= 1'b0;
+								rx_stb <= 1'b1;
+							end
+							else
+								// framing err
+								rx_err <= 1'b1;
 						end
-						else
-							// framing err
-							rx_err <= 1'b1;
 					end
 				end
-				else
-					rx_rcnt <= rx_rcnt - 1;
 			end
 		end
 endmodule
@@ -1,29 +1,39 @@
 // acia_tx.v - serial transmit submodule
 // 06-02-19 E. Brombaugh
+//
+// Bit timing uses the same fractional divider as acia_rx so the average
+// bit period is exact to 1/16 clock with at most one clock of jitter.
+
+`default_nettype none
 
 module acia_tx(
 	input clk,				// system clock
 	input rst,				// system reset
+	input [15:0] div,		// clocks per bit, 12.4 fixed point
 	input [7:0] tx_dat,		// transmit data byte
 	input tx_start,			// trigger transmission
 	output tx_serial,		// tx serial output
 	output reg tx_busy		// tx is active (not ready)
 );
-	// sym rate counter for 115200bps @ 16MHz clk
-    parameter SCW = 8;		// rate counter width
-	parameter sym_cnt = 139;	// rate count value
+	// oversampling ticks to match the receiver
+	wire os8 = ~|div[15:8];
+	wire [3:0] ph_last = os8 ? 4'd7 : 4'd15;
+	reg [15:0] tx_acc;
+	wire [16:0] tx_nxt = tx_acc + (os8 ? 16'd128 : 16'd256);
+	wire tick = (tx_nxt >= {1'b0,div});
 	
 	// transmit machine
 	reg [8:0] tx_sr;
 	reg [3:0] tx_bcnt;
-	reg [SCW-1:0] tx_rcnt;
+	reg [3:0] tx_ph;
 	always @(posedge clk)
 	begin
 		if(rst)
 		begin
 			tx_sr <= 9'h1ff;
 			tx_bcnt <= 4'h0;
-			tx_rcnt <= {SCW{1'b0}};
+			tx_acc <= 16'd0;
+			tx_ph <= 4'd0;
 			tx_busy <= 1'b0;
 		end
 		else
@@ -36,30 +46,34 @@ module acia_tx(
 					tx_busy <= 1'b1;
 					tx_sr <= {tx_dat,1'b0};
 					tx_bcnt <= 4'd9;
-					tx_rcnt <= sym_cnt;
+					tx_acc <= 16'd0;
+					tx_ph <= 4'd0;
 				end
 			end
 			else
 			begin
-				if(~|tx_rcnt)
+				tx_acc <= tick ? tx_nxt[15:0] - div : tx_nxt[15:0];
+				if(tick)
 				begin
-					// shift out next bit and restart
-					tx_sr <= {1'b1,tx_sr[8:1]};
-					tx_bcnt <= tx_bcnt - 1;
-					tx_rcnt <= sym_cnt;
+					tx_ph <= (tx_ph == ph_last) ? 4'd0 : tx_ph + 4'd1;
 					
-					if(~|tx_bcnt)
+					if(tx_ph == ph_last)
 					begin
-						// done - return to inactive state
-						tx_busy <= 1'b0;
+						// shift out next bit and restart
+						tx_sr <= {1'b1,tx_sr[8:1]};
+						tx_bcnt <= tx_bcnt - 1;
+						
+						if(~|tx_bcnt)
+						begin
+							// done - return to inactive state
+							tx_busy <= 1'b0;
+						end
 					end
 				end
-				else
-					tx_rcnt <= tx_rcnt - 1;
 			end	
 		end
 	end
 	
 	// hook up output
-	assign tx_serial = tx_sr;
+	assign tx_serial = tx_sr[0];
 endmodule
@@ -0,0 +1,59 @@
+// intc.v - simple interrupt controller for picorv32
+// 10-17-26 E. Brombaugh
+//
+// Sources are level-sensitive. A high source sets its pending bit which
+// stays set until acked, so a source still active after the ack pends
+// again. The output goes to a single picorv32 IRQ line.
+//
+// Register map (32-bit, word offsets):
+//  0 PEND   - R: pending sources. W: 1 acks (clears) pending bits
+//  1 ENABLE - R/W: source enables
+//  2 RAW    - R: current source levels
+
+`default_nettype none
+
+module intc(
+	input clk,					// system clock
+	input rst,					// system reset
+	input cs,					// chip select
+	input we,					// write enable
+	input [1:0] addr,			// register select
+	input [31:0] din,			// data bus input
+	output reg [31:0] dout,		// data bus output
+	input [NSRC-1:0] src,		// interrupt sources
+	output irq					// high-true interrupt to CPU
+);
+	parameter NSRC = 8;
+
+	reg [NSRC-1:0] pend, enable;
+	wire [NSRC-1:0] ack = (cs & we & (addr == 2'd0)) ? din[NSRC-1:0] :
+		{NSRC{1'b0}};
+
+	// pending & enable
+	always @(posedge clk)
+		if(rst)
+		begin
+			pend <= {NSRC{1'b0}};
+			enable <= {NSRC{1'b0}};
+		end
+		else
+		begin
+			pend <= (pend & ~ack) | src;
+
+			if(cs & we & (addr == 2'd1))
+				enable <= din[NSRC-1:0];
+		end
+
+	// register readback
+	always @(posedge clk)
+		if(cs & ~we)
+			case(addr)
+				2'd0: dout <= {{32-NSRC{1'b0}},pend};
+				2'd1: dout <= {{32-NSRC{1'b0}},enable};
+				2'd2: dout <= {{32-NSRC{1'b0}},src};
+				default: dout <= 32'd0;
+			endcase
+
+	assign irq = |(pend & enable);
+
+endmodule
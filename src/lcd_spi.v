@@ -0,0 +1,193 @@
+// lcd_spi.v - fabric SPI master for LCDs with FIFO, auto DC and fill
+// 10-17-26 E. Brombaugh
+//
+// Mode 0 transmit-only master. Writes queue an entry in a TX FIFO; the
+// register written selects what the entry sends and DC is driven from
+// the entry type so commands and data can be queued back to back. CS
+// goes low with the first entry and stays low until an END entry.
+//
+// Register map (32-bit, word offsets):
+//  0 CTRL  - W: [7:0] SCLK divider, half period = div+1 clocks
+//            R: [16+:AW+1] FIFO level, [2] CS active, [1] full, [0] busy
+//  1 CMD   - W: send d[7:0] with DC low
+//  2 DAT8  - W: send d[7:0] with DC high
+//  3 DAT16 - W: send pixel d[15:0] high byte first
+//  4 PIX2  - W: send pixels d[15:0] then d[31:16], high bytes first
+//  5 RAW4  - W: send d[7:0], d[15:8], d[23:16], d[31:24] (memory order)
+//  6 FILL  - W: send pixel d[15:0] d[31:16] times, 0 = 65536 times
+//  7 END   - W: release CS once preceding entries are sent
+
+`default_nettype none
+
+module lcd_spi(
+	input clk,					// system clock
+	input rst,					// system reset
+	input cs,					// chip select
+	input we,					// write enable
+	input [2:0] addr,			// register select
+	input [31:0] din,			// data bus input
+	output reg [31:0] dout,		// data bus output
+	output reg spi_cs_n,		// LCD chip select
+	output reg spi_sclk,		// LCD clock
+	output spi_mosi,			// LCD data
+	output reg spi_dc			// LCD data/command
+);
+	parameter AW = 8;			// log2 of FIFO depth
+
+	// entry types - register address less one
+	localparam T_CMD = 3'd0, T_DAT8 = 3'd1, T_DAT16 = 3'd2, T_PIX2 = 3'd3,
+		T_RAW4 = 3'd4, T_FILL = 3'd5, T_END = 3'd6;
+
+	// bus cycles last more than one clock so only act on the first
+	reg cs_d;
+	always @(posedge clk)
+		cs_d <= cs;
+	wire acc = cs & ~cs_d;
+
+	// clock divider
+	reg [7:0] div;
+	always @(posedge clk)
+		if(rst)
+			div <= 8'd0;
+		else if(acc & we & (addr == 3'd0))
+			div <= din[7:0];
+
+	// TX FIFO of {type, data}
+	wire [34:0] fifo_q;
+	wire fifo_empty, fifo_full, fifo_rd;
+	wire [AW:0] fifo_level;
+	acia_fifo #(
+		.DW(35),
+		.AW(AW)
+	)
+	tx_fifo(
+		.clk(clk),
+		.rst(rst),
+		.wr(acc & we & (addr != 3'd0)),
+		.din({addr - 3'd1, din}),
+		.rd(fifo_rd),
+		.dout(fifo_q),
+		.empty(fifo_empty),
+		.full(fifo_full),
+		.level(fifo_level)
+	);
+	wire [2:0] q_type = fifo_q[34:32];
+	wire [31:0] q_dat = fifo_q[31:0];
+
+	// shifter
+	localparam S_IDLE = 2'd0, S_LO = 2'd1, S_HI = 2'd2;
+	reg [1:0] state;
+	reg [31:0] sr;
+	reg [5:0] bits;
+	reg [15:0] rpt;
+	reg [15:0] fill;
+	reg [7:0] dcnt;
+	assign fifo_rd = (state == S_IDLE) & ~fifo_empty;
+	assign spi_mosi = sr[31];
+	always @(posedge clk)
+		if(rst)
+		begin
+			state <= S_IDLE;
+			spi_cs_n <= 1'b1;
+			spi_sclk <= 1'b0;
+			spi_dc <= 1'b1;
+			sr <= 32'd0;
+			bits <= 6'd0;
+			rpt <= 16'd0;
+			fill <= 16'd0;
+			dcnt <= 8'd0;
+		end
+		else
+			case(state)
+				S_IDLE:
+					if(~fifo_empty)
+					begin
+						// previous byte is complete so DC can change now
+						dcnt <= div;
+						rpt <= 16'd0;
+						if(q_type == T_END)
+							spi_cs_n <= 1'b1;
+						else
+						begin
+							spi_cs_n <= 1'b0;
+							spi_dc <= (q_type != T_CMD);
+							state <= S_LO;
+						end
+
+						case(q_type)
+							T_CMD, T_DAT8:
+							begin
+								sr <= {q_dat[7:0],24'd0};
+								bits <= 6'd8;
+							end
+							T_DAT16:
+							begin
+								sr <= {q_dat[15:0],16'd0};
+								bits <= 6'd16;
+							end
+							T_PIX2:
+							begin
+								sr <= {q_dat[15:0],q_dat[31:16]};
+								bits <= 6'd32;
+							end
+							T_RAW4:
+							begin
+								sr <= {q_dat[7:0],q_dat[15:8],q_dat[23:16],q_dat[31:24]};
+								bits <= 6'd32;
+							end
+							T_FILL:
+							begin
+								sr <= {q_dat[15:0],16'd0};
+								bits <= 6'd16;
+								fill <= q_dat[15:0];
+								rpt <= q_dat[31:16] - 16'd1;
+							end
+						endcase
+					end
+
+				S_LO:
+					if(|dcnt)
+						dcnt <= dcnt - 8'd1;
+					else
+					begin
+						dcnt <= div;
+						spi_sclk <= 1'b1;
+						state <= S_HI;
+					end
+
+				S_HI:
+					if(|dcnt)
+						dcnt <= dcnt - 8'd1;
+					else
+					begin
+						dcnt <= div;
+						spi_sclk <= 1'b0;
+						if(bits != 6'd1)
+						begin
+							sr <= {sr[30:0],1'b0};
+							bits <= bits - 6'd1;
+							state <= S_LO;
+						end
+						else if(|rpt)
+						begin
+							// next fill pixel
+							sr <= {fill,16'd0};
+							bits <= 6'd16;
+							rpt <= rpt - 16'd1;
+							state <= S_LO;
+						end
+						else
+							state <= S_IDLE;
+					end
+
+				default:
+					state <= S_IDLE;
+			endcase
+
+	// status readback
+	wire busy = ~fifo_empty | (state != S_IDLE);
+	always @(posedge clk)
+		if(cs & ~we)
+			dout <= {{15-AW{1'b0}},fifo_level,13'd0,~spi_cs_n,fifo_full,busy};
+
+endmodule
@@ -0,0 +1,304 @@
+// spi_dma.v - DMA engine between SPRAM and the SB_SPI hard cores
+// 10-17-26 E. Brombaugh
+//
+// Register map (32-bit, word offsets):
+//  0 CTRL   - W: bit0 start, bit1 txen, bit2 rxen, bit3 irqen, bit4 port
+//             R: bit0 busy, bits4:1 as written
+//  1 STAT   - R: bit0 busy, bit1 done. W: bit1 = 1 clears done
+//  2 TXADDR - SPRAM byte address of transmit buffer
+//  3 RXADDR - SPRAM byte address of receive buffer
+//  4 COUNT  - number of bytes to transfer
+//  5 FILL   - byte sent when txen is clear
+//
+// The engine polls SPISR over the SB Wishbone bus just as the firmware
+// does, but without the CPU bus round-trip so it keeps up with the wire.
+// SPRAM cycles are only taken when the CPU is not accessing RAM.
+
+`default_nettype none
+
+module spi_dma(
+	input clk,					// system clock
+	input rst,					// system reset
+	input cs,					// chip select
+	input we,					// write enable
+	input [2:0] addr,			// register select
+	input [31:0] din,			// data bus input
+	output reg [31:0] dout,		// data bus output
+	output irq,					// high-true interrupt request
+
+	output reg ram_req,			// SPRAM request
+	input ram_gnt,				// SPRAM grant
+	output reg [15:0] ram_addr,	// SPRAM byte address
+	output reg [3:0] ram_we,	// SPRAM byte write enables
+	output [31:0] ram_wdat,		// SPRAM write data
+	input [31:0] ram_rdat,		// SPRAM read data
+
+	output reg wb_stbo,			// wishbone STB
+	output reg [7:0] wb_adro,	// wishbone Address
+	output reg wb_rwo,			// wishbone read/write
+	output reg [7:0] wb_dato,	// wishbone data out
+	input wb_acki,				// wishbone ACK
+	input [7:0] wb_dati			// wishbone data in
+);
+	// SB_SPI register offsets
+	localparam SPISR = 4'hC;
+	localparam SPITXDR = 4'hD;
+	localparam SPIRXDR = 4'hE;
+
+	// transfer states
+	localparam S_IDLE  = 4'd0;	// waiting for start
+	localparam S_FETCH = 4'd1;	// read next tx word from SPRAM
+	localparam S_FDAT  = 4'd2;	// latch SPRAM read data
+	localparam S_TRDY  = 4'd3;	// poll SPISR for TRDY
+	localparam S_TXD   = 4'd4;	// write SPITXDR
+	localparam S_RRDY  = 4'd5;	// poll SPISR for RRDY
+	localparam S_RXD   = 4'd6;	// read SPIRXDR
+	localparam S_STORE = 4'd7;	// write rx byte to SPRAM
+	localparam S_NEXT  = 4'd8;	// advance pointers
+	localparam S_DRAIN = 4'd9;	// wait for last tx byte to finish
+
+	// descriptor & state
+	reg [3:0] state;
+	reg [15:0] tx_addr, rx_addr, count;
+	reg [7:0] fill, rx_byte;
+	reg txen, rxen, irqen, port, busy, done;
+	reg [31:0] tx_word;
+	reg tx_valid;
+
+	// byte lane select for transmit data
+	reg [7:0] tx_byte;
+	always @(*)
+		if(!txen)
+			tx_byte = fill;
+		else
+			case(tx_addr[1:0])
+				2'b00: tx_byte = tx_word[7:0];
+				2'b01: tx_byte = tx_word[15:8];
+				2'b10: tx_byte = tx_word[23:16];
+				2'b11: tx_byte = tx_word[31:24];
+			endcase
+
+	// rx bytes are written to all lanes & masked by ram_we
+	assign ram_wdat = {4{rx_byte}};
+
+	// SB bus address of the selected core's registers
+	wire [3:0] sb_core = {2'b00,port,1'b0};
+
+	// register writes and transfer machine
+	always @(posedge clk)
+		if(rst)
+		begin
+			state <= S_IDLE;
+			tx_addr <= 16'h0000;
+			rx_addr <= 16'h0000;
+			count <= 16'h0000;
+			fill <= 8'hff;
+			rx_byte <= 8'h00;
+			txen <= 1'b0;
+			rxen <= 1'b0;
+			irqen <= 1'b0;
+			port <= 1'b0;
+			busy <= 1'b0;
+			done <= 1'b0;
+			tx_valid <= 1'b0;
+			ram_req <= 1'b0;
+			ram_addr <= 16'h0000;
+			ram_we <= 4'h0;
+			wb_stbo <= 1'b0;
+			wb_adro <= 8'h00;
+			wb_rwo <= 1'b0;
+			wb_dato <= 8'h00;
+		end
+		else
+		begin
+			// descriptor writes are ignored while a transfer is running
+			if(cs & we & ~busy)
+				case(addr)
+					3'h0:
+					begin
+						{port,irqen,rxen,txen} <= din[4:1];
+						if(din[0])
+						begin
+							tx_valid <= 1'b0;
+							if(|count)
+							begin
+								busy <= 1'b1;
+								done <= 1'b0;
+								state <= S_FETCH;
+							end
+							else
+								done <= 1'b1;
+						end
+					end
+					3'h1: if(din[1]) done <= 1'b0;
+					3'h2: tx_addr <= din[15:0];
+					3'h3: rx_addr <= din[15:0];
+					3'h4: count <= din[15:0];
+					3'h5: fill <= din[7:0];
+				endcase
+
+			case(state)
+				S_IDLE: ;
+
+				S_FETCH:
+					if(!txen || tx_valid)
+						state <= S_TRDY;
+					else if(!ram_req)
+					begin
+						ram_req <= 1'b1;
+						ram_addr <= tx_addr;
+						ram_we <= 4'h0;
+					end
+					else if(ram_gnt)
+					begin
+						ram_req <= 1'b0;
+						state <= S_FDAT;
+					end
+
+				S_FDAT:
+				begin
+					tx_word <= ram_rdat;
+					tx_valid <= 1'b1;
+					state <= S_TRDY;
+				end
+
+				S_TRDY:
+					if(!wb_stbo)
+					begin
+						wb_stbo <= 1'b1;
+						wb_adro <= {sb_core,SPISR};
+						wb_rwo <= 1'b0;
+					end
+					else if(wb_acki)
+					begin
+						wb_stbo <= 1'b0;
+						if(wb_dati[4])
+							state <= S_TXD;
+					end
+
+				S_TXD:
+					if(!wb_stbo)
+					begin
+						wb_stbo <= 1'b1;
+						wb_adro <= {sb_core,SPITXDR};
+						wb_rwo <= 1'b1;
+						wb_dato <= tx_byte;
+					end
+					else if(wb_acki)
+					begin
+						wb_stbo <= 1'b0;
+						state <= rxen ? S_RRDY : S_NEXT;
+					end
+
+				S_RRDY:
+					if(!wb_stbo)
+					begin
+						wb_stbo <= 1'b1;
+						wb_adro <= {sb_core,SPISR};
+						wb_rwo <= 1'b0;
+					end
+					else if(wb_acki)
+					begin
+						wb_stbo <= 1'b0;
+						if(wb_dati[3])
+							state <= S_RXD;
+					end
+
+				S_RXD:
+					if(!wb_stbo)
+					begin
+						wb_stbo <= 1'b1;
+						wb_adro <= {sb_core,SPIRXDR};
+						wb_rwo <= 1'b0;
+					end
+					else if(wb_acki)
+					begin
+						wb_stbo <= 1'b0;
+						rx_byte <= wb_dati;
+						state <= S_STORE;
+					end
+
+				S_STORE:
+					if(!ram_req)
+					begin
+						ram_req <= 1'b1;
+						ram_addr <= rx_addr;
+						ram_we <= 4'b0001 << rx_addr[1:0];
+					end
+					else if(ram_gnt)
+					begin
+						ram_req <= 1'b0;
+						ram_we <= 4'h0;
+						state <= S_NEXT;
+					end
+
+				S_NEXT:
+				begin
+					count <= count - 16'd1;
+					if(txen)
+					begin
+						tx_addr <= tx_addr + 16'd1;
+						if(&tx_addr[1:0])
+							tx_valid <= 1'b0;
+					end
+					if(rxen)
+						rx_addr <= rx_addr + 16'd1;
+
+					if(count == 16'd1)
+					begin
+						if(rxen)
+						begin
+							// last byte already received
+							busy <= 1'b0;
+							done <= 1'b1;
+							state <= S_IDLE;
+						end
+						else
+							state <= S_DRAIN;
+					end
+					else
+						state <= S_FETCH;
+				end
+
+				S_DRAIN:
+					if(!wb_stbo)
+					begin
+						wb_stbo <= 1'b1;
+						wb_adro <= {sb_core,SPISR};
+						wb_rwo <= 1'b0;
+					end
+					else if(wb_acki)
+					begin
+						wb_stbo <= 1'b0;
+
+						// TRDY and not TIP
+						if(wb_dati[4] & ~wb_dati[7])
+						begin
+							busy <= 1'b0;
+							done <= 1'b1;
+							state <= S_IDLE;
+						end
+					end
+
+				default:
+					state <= S_IDLE;
+			endcase
+		end
+
+	// register readback
+	always @(posedge clk)
+		if(cs & ~we)
+			case(addr)
+				3'h0: dout <= {27'd0,port,irqen,rxen,txen,busy};
+				3'h1: dout <= {30'd0,done,busy};
+				3'h2: dout <= {16'd0,tx_addr};
+				3'h3: dout <= {16'd0,rx_addr};
+				3'h4: dout <= {16'd0,count};
+				3'h5: dout <= {24'd0,fill};
+				default: dout <= 32'd0;
+			endcase
+
+	// completion interrupt
+	assign irq = done & irqen;
+
+endmodule
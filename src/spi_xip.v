@@ -0,0 +1,419 @@
+// spi_xip.v - execute-in-place SPI flash reader with direct-mapped cache
+// 10-17-26 E. Brombaugh
+//
+// Maps the 16MB flash 1:1 into a read-only window. Misses fetch a whole
+// line at clk/2 with the read command set in MODE - 0x03 READ after
+// reset, or 0x0B fast, 0x3B dual output or 0x6B quad output reads once
+// software has found what the part supports. Command and address are
+// always sent one bit wide; only the data phase uses IO1..IO3.
+//
+// A second, uncached window streams words for bulk copies. The read is
+// left open after each word and the next word is prefetched, so a
+// sequential copy pays the command overhead once and overlaps shifting
+// with the CPU's stores. The stream is closed by a cache miss, a
+// non-sequential read, a MODE write or the SB core taking its CS.
+//
+// The flash pins are shared with SB_SPI0 and are only taken while the SB
+// core's CS is inactive, so code which drives SPI0 must not itself
+// execute from this window. They are handed back one clock after the
+// reader raises CS, so there is always a CS-high clock before the SB
+// core's transfer even when it takes CS while a stream is open.
+//
+// Register map (reg_cs, 32-bit, word offsets):
+//  0 CTRL   - W: bit0 flush cache, bit1 clear counters, bit2 close stream
+//             R: bit0 flushing, bit1 stream open, bit2 quad pins present
+//  1 HITS   - cache hit count
+//  2 MISSES - cache miss count
+//  3 MODE   - [7:0] read opcode, [11:8] dummy clocks,
+//             [13:12] data width 0 = x1, 1 = x2, 2 = x4
+
+`default_nettype none
+
+module spi_xip(
+	input clk,					// system clock
+	input rst,					// system reset
+	input cs,					// memory window select
+	input str_cs,				// stream window select
+	input reg_cs,				// register select
+	input we,					// write enable
+	input [23:0] addr,			// byte address
+	input [31:0] din,			// data bus input
+	output [31:0] dout,			// data bus output
+	output rdy,					// high-true ready flag
+
+	input flash_free,			// SB_SPI0 CS inactive
+	output reg flash_own,		// XIP driving flash pins
+	output reg flash_cs_n,		// flash CS
+	output reg flash_sclk,		// flash SCLK
+	output flash_mosi,			// flash MOSI / IO0 out
+	output reg flash_mosi_oe,	// IO0 driven, released for x2/x4 data
+	input flash_io0,			// flash IO0 in
+	input flash_miso,			// flash MISO / IO1 in
+	output reg flash_io23_oe,	// IO2/IO3 driven high (WP#/HOLD#)
+	input [1:0] flash_io23		// flash IO2/IO3 in
+);
+	// cache geometry - 2kB of 16-byte lines by default
+	parameter CACHE_AW = 9;		// log2 of words in cache
+	parameter LINE_AW = 2;		// log2 of words per line
+	parameter QUAD = 0;			// IO2/IO3 wired to the flash
+	localparam IDX_W = CACHE_AW - LINE_AW;
+	localparam TAG_W = 24 - CACHE_AW - 2;
+
+	// states
+	localparam S_FLUSH = 3'd0;	// clearing tags
+	localparam S_IDLE  = 3'd1;	// waiting for access
+	localparam S_CHECK = 3'd2;	// compare tag
+	localparam S_WAIT  = 3'd3;	// waiting for flash pins
+	localparam S_CMD   = 3'd4;	// sending command + address
+	localparam S_DUMMY = 3'd5;	// dummy clocks
+	localparam S_DATA  = 3'd6;	// receiving line or stream word
+	localparam S_DONE  = 3'd7;	// let last writes land before lookup
+
+	// address fields
+	wire [TAG_W-1:0] a_tag = addr[23:CACHE_AW+2];
+	wire [IDX_W-1:0] a_line = addr[CACHE_AW+1:LINE_AW+2];
+	wire [CACHE_AW-1:0] a_word = addr[CACHE_AW+1:2];
+
+	// cache memories
+	reg [31:0] data_mem[0:(1<<CACHE_AW)-1];
+	reg [TAG_W:0] tag_mem[0:(1<<IDX_W)-1];
+	reg [31:0] data_q;
+	reg [TAG_W:0] tag_q;
+	reg data_we, tag_we;
+	reg [CACHE_AW-1:0] data_wa;
+	reg [31:0] data_wd;
+	reg [IDX_W-1:0] tag_wa;
+	reg [TAG_W:0] tag_wd;
+	always @(posedge clk)
+	begin
+		data_q <= data_mem[a_word];
+		if(data_we)
+			data_mem[data_wa] <= data_wd;
+	end
+	always @(posedge clk)
+	begin
+		tag_q <= tag_mem[a_line];
+		if(tag_we)
+			tag_mem[tag_wa] <= tag_wd;
+	end
+
+	// read mode
+	reg [7:0] m_op;
+	reg [3:0] m_dummy;
+	reg [1:0] m_width;
+	wire [5:0] m_bits = (m_width == 2'd0) ? 6'd31 :
+						(m_width == 2'd1) ? 6'd15 : 6'd7;
+
+	// hit detect
+	reg [2:0] state;
+	wire hit = (tag_q == {1'b1,a_tag});
+	wire mem_rdy = (state == S_CHECK) & cs & hit;
+
+	// stream prefetch word
+	reg open, pf_vld;
+	reg [21:0] pf_adr, nxt;
+	reg [31:0] pf_buf;
+	wire pf_hit = pf_vld & (pf_adr == addr[23:2]);
+	wire str_rdy = (state == S_IDLE) & str_cs & ~we & pf_hit;
+
+	// line fill / stream machine
+	reg [31:0] sr_out, sr_in;
+	reg [5:0] bcnt;
+	reg [LINE_AW-1:0] wcnt;
+	reg refill, fill, flush_req, clr_req, close_req;
+	reg [31:0] hits, misses;
+	wire [3:0] io = {flash_io23,flash_miso,flash_io0};
+	wire [31:0] sr_nxt = (m_width == 2'd0) ? {sr_in[30:0],io[1]} :
+						 (m_width == 2'd1) ? {sr_in[29:0],io[1:0]} :
+											 {sr_in[27:0],io};
+	// flash is byte-serial, bus is little-endian
+	wire [31:0] sr_word = {sr_nxt[7:0],sr_nxt[15:8],sr_nxt[23:16],sr_nxt[31:24]};
+	wire abort = ~fill & ~flash_free;
+	assign flash_mosi = sr_out[31];
+	always @(posedge clk)
+		if(rst)
+		begin
+			state <= S_FLUSH;
+			tag_wa <= {IDX_W{1'b0}};
+			tag_we <= 1'b0;
+			data_we <= 1'b0;
+			refill <= 1'b0;
+			fill <= 1'b0;
+			open <= 1'b0;
+			pf_vld <= 1'b0;
+			hits <= 32'd0;
+			misses <= 32'd0;
+			flash_own <= 1'b0;
+			flash_cs_n <= 1'b1;
+			flash_sclk <= 1'b0;
+			flash_mosi_oe <= 1'b1;
+			flash_io23_oe <= 1'b0;
+			sr_out <= 32'd0;
+		end
+		else
+		begin
+			tag_we <= 1'b0;
+			data_we <= 1'b0;
+
+			// pins go back a clock after CS rises, so the flash sees CS high
+			// between the reader and an SB core that took CS mid-stream
+			if(flash_own & flash_cs_n)
+				flash_own <= 1'b0;
+
+			if(clr_req)
+			begin
+				hits <= 32'd0;
+				misses <= 32'd0;
+			end
+
+			case(state)
+				S_FLUSH:
+				begin
+					// invalidate one line per clock
+					tag_wd <= {(TAG_W+1){1'b0}};
+					tag_we <= 1'b1;
+					if(tag_we)
+						tag_wa <= tag_wa + 1;
+					if(tag_we && (&tag_wa))
+					begin
+						tag_we <= 1'b0;
+						state <= S_IDLE;
+					end
+				end
+
+				S_IDLE:
+					if(flush_req | close_req | (open & ~flash_free))
+					begin
+						// end the read, prefetched word stays good
+						open <= 1'b0;
+						flash_cs_n <= 1'b1;
+						if(flush_req)
+						begin
+							pf_vld <= 1'b0;
+							tag_wa <= {IDX_W{1'b0}};
+							state <= S_FLUSH;
+						end
+					end
+					else if(cs & ~we)
+						state <= S_CHECK;
+					else if(str_cs & ~we)
+					begin
+						fill <= 1'b0;
+						if(pf_hit)
+							// data presented this cycle, prefetch the next
+							pf_vld <= 1'b0;
+						else if(open & ~pf_vld & (nxt == addr[23:2]))
+						begin
+							bcnt <= m_bits;
+							state <= S_DATA;
+						end
+						else
+						begin
+							// restart the read at the new address
+							open <= 1'b0;
+							pf_vld <= 1'b0;
+							flash_cs_n <= 1'b1;
+							state <= S_WAIT;
+						end
+					end
+					else if(open & ~pf_vld)
+					begin
+						fill <= 1'b0;
+						bcnt <= m_bits;
+						state <= S_DATA;
+					end
+
+				S_CHECK:
+					if(!cs)
+						state <= S_IDLE;
+					else if(hit)
+					begin
+						// data presented this cycle
+						if(!refill)
+							hits <= hits + 32'd1;
+						refill <= 1'b0;
+						state <= S_IDLE;
+					end
+					else
+					begin
+						misses <= misses + 32'd1;
+						refill <= 1'b1;
+						fill <= 1'b1;
+						open <= 1'b0;
+						flash_cs_n <= 1'b1;
+						state <= S_WAIT;
+					end
+
+				S_WAIT:
+					if(flash_free)
+					begin
+						// take the pins and send the read command + address
+						flash_own <= 1'b1;
+						flash_cs_n <= 1'b0;
+						flash_mosi_oe <= 1'b1;
+						flash_io23_oe <= (QUAD != 0);
+						if(fill)
+							sr_out <= {m_op,addr[23:LINE_AW+2],{LINE_AW+2{1'b0}}};
+						else
+							sr_out <= {m_op,addr[23:2],2'b00};
+						nxt <= addr[23:2];
+						bcnt <= 6'd31;
+						state <= S_CMD;
+					end
+
+				S_CMD:
+					if(abort)
+						state <= S_IDLE;
+					else if(!flash_sclk)
+						flash_sclk <= 1'b1;
+					else
+					begin
+						flash_sclk <= 1'b0;
+						sr_out <= {sr_out[30:0],1'b0};
+						bcnt <= bcnt - 6'd1;
+						if(~|bcnt)
+						begin
+							// wide data comes back on the other pins
+							flash_mosi_oe <= (m_width == 2'd0);
+							flash_io23_oe <= (QUAD != 0) && (m_width != 2'd2);
+							bcnt <= m_bits;
+							wcnt <= {LINE_AW{1'b0}};
+							if(|m_dummy)
+							begin
+								bcnt <= {2'b00,m_dummy} - 6'd1;
+								state <= S_DUMMY;
+							end
+							else
+								state <= S_DATA;
+						end
+					end
+
+				S_DUMMY:
+					if(abort)
+						state <= S_IDLE;
+					else if(!flash_sclk)
+						flash_sclk <= 1'b1;
+					else
+					begin
+						flash_sclk <= 1'b0;
+						bcnt <= bcnt - 6'd1;
+						if(~|bcnt)
+						begin
+							bcnt <= m_bits;
+							state <= S_DATA;
+						end
+					end
+
+				S_DATA:
+					if(abort)
+						state <= S_IDLE;
+					else if(!flash_sclk)
+						flash_sclk <= 1'b1;
+					else
+					begin
+						// sample while SCLK high
+						flash_sclk <= 1'b0;
+						sr_in <= sr_nxt;
+						bcnt <= bcnt - 6'd1;
+						if(~|bcnt)
+						begin
+							bcnt <= m_bits;
+							if(fill)
+							begin
+								data_wa <= {a_line,wcnt};
+								data_wd <= sr_word;
+								data_we <= 1'b1;
+								wcnt <= wcnt + 1;
+								if(&wcnt)
+								begin
+									// line done - mark valid and end the read
+									tag_wa <= a_line;
+									tag_wd <= {1'b1,a_tag};
+									tag_we <= 1'b1;
+									flash_cs_n <= 1'b1;
+									state <= S_DONE;
+								end
+							end
+							else
+							begin
+								// hold CS low so the next word follows on
+								pf_buf <= sr_word;
+								pf_adr <= nxt;
+								pf_vld <= 1'b1;
+								nxt <= nxt + 22'd1;
+								open <= 1'b1;
+								state <= S_IDLE;
+							end
+						end
+					end
+
+				S_DONE:
+					state <= S_IDLE;
+
+				default:
+					state <= S_IDLE;
+			endcase
+
+			// SB core wants the pins back - the stream is lost
+			if(abort & ((state == S_CMD) | (state == S_DUMMY) | (state == S_DATA)))
+			begin
+				open <= 1'b0;
+				flash_sclk <= 1'b0;
+				flash_cs_n <= 1'b1;
+			end
+		end
+
+	// control registers
+	reg [31:0] reg_do;
+	reg reg_rdy;
+	always @(posedge clk)
+		if(rst)
+		begin
+			reg_rdy <= 1'b0;
+			flush_req <= 1'b0;
+			clr_req <= 1'b0;
+			close_req <= 1'b0;
+			m_op <= 8'h03;
+			m_dummy <= 4'd0;
+			m_width <= 2'd0;
+		end
+		else
+		begin
+			// writes to the memory windows are acked and ignored
+			reg_rdy <= (reg_cs | ((cs | str_cs) & we)) & ~reg_rdy;
+			clr_req <= 1'b0;
+			if(state == S_FLUSH)
+				flush_req <= 1'b0;
+			if(state == S_IDLE)
+				close_req <= 1'b0;
+
+			if(reg_cs & we & ~reg_rdy)
+				case(addr[3:2])
+					2'b00:
+					begin
+						flush_req <= din[0];
+						clr_req <= din[1];
+						close_req <= din[2];
+					end
+					2'b11:
+					begin
+						// new command applies from the next read
+						m_op <= din[7:0];
+						m_dummy <= din[11:8];
+						m_width <= din[13:12];
+						close_req <= 1'b1;
+					end
+				endcase
+
+			case(addr[3:2])
+				2'b00: reg_do <= {29'd0,(QUAD != 0),open,(state == S_FLUSH)};
+				2'b01: reg_do <= hits;
+				2'b10: reg_do <= misses;
+				2'b11: reg_do <= {18'd0,m_width,m_dummy,m_op};
+			endcase
+		end
+
+	assign dout = reg_cs ? reg_do : str_cs ? pf_buf : data_q;
+	assign rdy = mem_rdy | str_rdy | reg_rdy;
+
+endmodule
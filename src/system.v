@@ -16,17 +16,51 @@ module system(
 			spi0_miso,
 			spi0_sclk,
 			spi0_cs0,
+	output	spi0_cs1,
+			spi0_cs2,
+			spi0_cs3,
 	
 	inout	spi1_mosi,		// SPI core 1
 			spi1_miso,
 			spi1_sclk,
 			spi1_cs0,
+	output	spi1_cs1,
+			spi1_cs2,
+			spi1_cs3,
 	
 	inout	i2c0_sda,		// I2C core 0
 			i2c0_scl,
 	
-	output reg [31:0] gp_out
+	inout	i2c1_sda,		// I2C core 1
+			i2c1_scl,
+	
+	output [31:0] gp_out
 );
+	// use picorv32 look-ahead to give single-cycle ROM & RAM
+	parameter LA_MEM = 1;
+	
+	// CPU performance profile - must match -march in c/Makefile
+`ifdef CPU_FAST
+	localparam CPU_BARREL = 1;	// rv32im: barrel shifter, fast mul, div
+	localparam CPU_MULDIV = 1;
+	localparam CPU_RVC = 0;
+`elsif CPU_COMPRESSED
+	localparam CPU_BARREL = 0;	// rv32ic: compressed instructions
+	localparam CPU_MULDIV = 0;
+	localparam CPU_RVC = 1;
+`else
+	localparam CPU_BARREL = 0;	// rv32i: smallest
+	localparam CPU_MULDIV = 0;
+	localparam CPU_RVC = 0;
+`endif
+	
+	// LCD on SPI1 pins from SB_SPI1 or the fabric lcd_spi master
+`ifdef LCD_SPI
+	localparam LCD_FABRIC = 1;
+`else
+	localparam LCD_FABRIC = 0;
+`endif
+	
 	// CPU
 	wire        mem_valid;
 	wire        mem_instr;
@@ -35,16 +69,22 @@ module system(
 	reg  [31:0] mem_rdata;
 	wire [31:0] mem_wdata;
 	wire [ 3:0] mem_wstrb;
+	wire        mem_la_read;
+	wire [31:0] mem_la_addr;
+	wire        intc_irq;
 	picorv32 #(
 		.PROGADDR_RESET(32'h 0000_0000),	// start or ROM
 		.STACKADDR(32'h 1001_0000),			// end of SPRAM
-		.BARREL_SHIFTER(0),
-		.COMPRESSED_ISA(0),
+		.BARREL_SHIFTER(CPU_BARREL),
+		.COMPRESSED_ISA(CPU_RVC),
 		.ENABLE_COUNTERS(0),
 		.ENABLE_MUL(0),
-		.ENABLE_DIV(0),
-		.ENABLE_IRQ(0),
-		.ENABLE_IRQ_QREGS(0),
+		.ENABLE_FAST_MUL(CPU_MULDIV),
+		.ENABLE_DIV(CPU_MULDIV),
+		.ENABLE_IRQ(1),
+		.ENABLE_IRQ_QREGS(1),
+		.ENABLE_IRQ_TIMER(0),
+		.PROGADDR_IRQ(32'h 0000_0010),		// vector in start.S
 		.CATCH_MISALIGN(0),
 		.CATCH_ILLINSN(0)
 	) cpu_I (
@@ -56,7 +96,10 @@ module system(
 		.mem_addr  (mem_addr),
 		.mem_wdata (mem_wdata),
 		.mem_wstrb (mem_wstrb),
-		.mem_rdata (mem_rdata)
+		.mem_rdata (mem_rdata),
+		.mem_la_read (mem_la_read),
+		.mem_la_addr (mem_la_addr),
+		.irq       ({28'd0,intc_irq,3'd0})	// IRQ 3 from controller
 	);
 	
 	// Address decode
@@ -66,115 +109,275 @@ module system(
 	wire ser_sel = (mem_addr[31:28]==4'h3)&mem_valid ? 1'b1 : 1'b0;
 	wire wbb_sel = (mem_addr[31:28]==4'h4)&mem_valid ? 1'b1 : 1'b0;
 	wire cnt_sel = (mem_addr[31:28]==4'h5)&mem_valid ? 1'b1 : 1'b0;
+	wire xip_sel = (mem_addr[31:24]==8'h60)&mem_valid ? 1'b1 : 1'b0;
+	wire xrg_sel = (mem_addr[31:24]==8'h61)&mem_valid ? 1'b1 : 1'b0;
+	wire xst_sel = (mem_addr[31:24]==8'h62)&mem_valid ? 1'b1 : 1'b0;
+	wire dma_sel = (mem_addr[31:28]==4'h7)&mem_valid ? 1'b1 : 1'b0;
+	wire int_sel = (mem_addr[31:28]==4'h8)&mem_valid ? 1'b1 : 1'b0;
+	wire lcd_sel = (mem_addr[31:28]==4'h9)&mem_valid ? 1'b1 : 1'b0;
+	
+	// With LA_MEM the ROM & RAM reads are started from the look-ahead
+	// address one cycle before mem_valid so data is ready immediately.
+	wire [31:0] rom_addr = LA_MEM ? mem_la_addr : mem_addr;
+	wire ram_la = LA_MEM && mem_la_read && (mem_la_addr[31:28]==4'h1);
 	
 	// 2k x 32 ROM
 	reg [31:0] rom[2047:0], rom_do;
 	initial
         $readmemh("rom.hex",rom);		
 	always @(posedge clk24)
-		rom_do <= rom[mem_addr[12:2]];
+		rom_do <= rom[rom_addr[12:2]];
 	
-	// RAM, byte addressable
+	// RAM, byte addressable. DMA gets cycles the CPU isn't using.
 	wire [31:0] ram_do;
+	wire dma_ram_req;
+	wire [15:0] dma_ram_addr;
+	wire [3:0] dma_ram_we;
+	wire [31:0] dma_ram_wdat;
+	wire dma_ram_gnt = dma_ram_req & ~ram_sel & ~ram_la;
 	spram_16kx32 uram(
 		.clk(clk24),
-		.sel(ram_sel),
-		.we(mem_wstrb),
-		.addr(mem_addr[15:0]),
-		.wdat(mem_wdata),
+		.sel(ram_la | ram_sel | dma_ram_gnt),
+		.we(ram_la ? 4'h0 : ram_sel ? mem_wstrb : dma_ram_we),
+		.addr(ram_la ? mem_la_addr[15:0] :
+			ram_sel ? mem_addr[15:0] : dma_ram_addr),
+		.wdat(ram_sel ? mem_wdata : dma_ram_wdat),
 		.rdat(ram_do)
 	);
 	
-	// GPIO
+	// GPIO - bit 30 is LCD DC, driven by lcd_spi when it's in use. Writes
+	// to 0x20000004 are benchmark markers for the testbench and ignored.
+	reg [31:0] gpo;
+	wire lcd_dc;
 	always @(posedge clk24)
-		if(gpo_sel)
+		if(gpo_sel & ~mem_addr[2])
 		begin
 			if(mem_wstrb[0])
-				gp_out[7:0] <= mem_wdata[7:0];
+				gpo[7:0] <= mem_wdata[7:0];
 			if(mem_wstrb[1])
-				gp_out[15:8] <= mem_wdata[15:8];
+				gpo[15:8] <= mem_wdata[15:8];
 			if(mem_wstrb[2])
-				gp_out[23:16] <= mem_wdata[23:16];
+				gpo[23:16] <= mem_wdata[23:16];
 			if(mem_wstrb[3])
-				gp_out[31:24] <= mem_wdata[31:24];
+				gpo[31:24] <= mem_wdata[31:24];
 		end
+	assign gp_out = LCD_FABRIC ? {gpo[31],lcd_dc,gpo[29:0]} : gpo;
 	
 	// Serial
 	wire [7:0] ser_do;
+	wire ser_irq;
 	acia uacia(
 		.clk(clk24),			// system clock
 		.rst(reset),			// system reset
 		.cs(ser_sel),			// chip select
 		.we(mem_wstrb[0]),		// write enable
-		.rs(mem_addr[2]),		// address
+		.rs(mem_addr[4:2]),		// address
 		.rx(RX),				// serial receive
 		.din(mem_wdata[7:0]),	// data bus input
 		.dout(ser_do),			// data bus output
 		.tx(TX),				// serial transmit
-		.irq()					// interrupt request
+		.irq(ser_irq)			// interrupt request
+	);
+	
+	// XIP flash window @ 6000_0000, cache regs @ 6100_0000,
+	// uncached stream window @ 6200_0000
+	wire [31:0] xip_do;
+	wire xip_rdy, xip_own, xip_cs_n, xip_sclk, xip_mosi, xip_miso, spi0_free;
+	wire xip_mosi_oe, xip_io0;
+	spi_xip uxip(
+		.clk(clk24),			// system clock
+		.rst(reset),			// system reset
+		.cs(xip_sel),			// memory window select
+		.str_cs(xst_sel),		// stream window select
+		.reg_cs(xrg_sel),		// register select
+		.we(|mem_wstrb),		// write enable
+		.addr(mem_addr[23:0]),	// address
+		.din(mem_wdata),		// data bus input
+		.dout(xip_do),			// data bus output
+		.rdy(xip_rdy),			// ready
+		.flash_free(spi0_free),	// SB_SPI0 idle
+		.flash_own(xip_own),	// XIP owns flash pins
+		.flash_cs_n(xip_cs_n),	// flash cs
+		.flash_sclk(xip_sclk),	// flash sclk
+		.flash_mosi(xip_mosi),	// flash mosi
+		.flash_mosi_oe(xip_mosi_oe),	// flash mosi output enable
+		.flash_io0(xip_io0),	// flash IO0 in
+		.flash_miso(xip_miso),	// flash miso
+		.flash_io23_oe(),		// IO2/IO3 not pinned out
+		.flash_io23(2'b11)		// IO2/IO3 in
+	);
+	
+	// SPI DMA engine
+	wire [31:0] dma_do;
+	wire dma_irq;
+	wire dma_wb_stb, dma_wb_rw, dma_wb_ack;
+	wire [7:0] dma_wb_adr, dma_wb_dato, dma_wb_dati;
+	spi_dma udma(
+		.clk(clk24),			// system clock
+		.rst(reset),			// system reset
+		.cs(dma_sel),			// chip select
+		.we(|mem_wstrb),		// write enable
+		.addr(mem_addr[4:2]),	// register select
+		.din(mem_wdata),		// data bus input
+		.dout(dma_do),			// data bus output
+		.irq(dma_irq),			// interrupt request
+		.ram_req(dma_ram_req),	// SPRAM request
+		.ram_gnt(dma_ram_gnt),	// SPRAM grant
+		.ram_addr(dma_ram_addr),// SPRAM address
+		.ram_we(dma_ram_we),	// SPRAM write enables
+		.ram_wdat(dma_ram_wdat),// SPRAM write data
+		.ram_rdat(ram_do),		// SPRAM read data
+		.wb_stbo(dma_wb_stb),	// wishbone STB
+		.wb_adro(dma_wb_adr),	// wishbone address
+		.wb_rwo(dma_wb_rw),		// wishbone read/write
+		.wb_dato(dma_wb_dato),	// wishbone data out
+		.wb_acki(dma_wb_ack),	// wishbone ACK
+		.wb_dati(dma_wb_dati)	// wishbone data in
+	);
+	
+	// fabric LCD SPI master - only built when selected
+	wire [31:0] lcd_do;
+	wire lcd_cs_n, lcd_sclk, lcd_mosi;
+`ifdef LCD_SPI
+	lcd_spi ulcd(
+		.clk(clk24),			// system clock
+		.rst(reset),			// system reset
+		.cs(lcd_sel),			// chip select
+		.we(|mem_wstrb),		// write enable
+		.addr(mem_addr[4:2]),	// register select
+		.din(mem_wdata),		// data bus input
+		.dout(lcd_do),			// data bus output
+		.spi_cs_n(lcd_cs_n),	// LCD cs
+		.spi_sclk(lcd_sclk),	// LCD sclk
+		.spi_mosi(lcd_mosi),	// LCD mosi
+		.spi_dc(lcd_dc)			// LCD data/command
 	);
+`else
+	assign lcd_do = 32'd0;
+	assign lcd_cs_n = 1'b1;
+	assign lcd_sclk = 1'b0;
+	assign lcd_mosi = 1'b0;
+	assign lcd_dc = 1'b1;
+`endif
 	
 	// 256B Wishbone bus master and SB IP cores @ F100-F1FF
-	wire [7:0] wbb_do;
+	wire [31:0] wbb_do;
 	wire wbb_rdy;
+	wire spi0_irq, spi1_irq, i2c0_irq, i2c1_irq;
 	wb_bus uwbb(
 		.clk(clk24),			// system clock
 		.rst(reset),			// system reset
 		.cs(wbb_sel),			// chip select
-		.we(mem_wstrb[0]),		// write enable
-		.addr(mem_addr[9:2]),	// address
-		.din(mem_wdata[7:0]),	// data bus input
+		.we(mem_wstrb),			// byte write enables
+		.addr(mem_addr[10:2]),	// address
+		.din(mem_wdata),		// data bus input
 		.dout(wbb_do),			// data bus output
 		.rdy(wbb_rdy),			// bus ready
+		.dma_stb(dma_wb_stb),	// DMA wishbone STB
+		.dma_adr(dma_wb_adr),	// DMA wishbone address
+		.dma_rw(dma_wb_rw),		// DMA wishbone read/write
+		.dma_dat(dma_wb_dato),	// DMA wishbone data out
+		.dma_ack(dma_wb_ack),	// DMA wishbone ACK
+		.dma_dati(dma_wb_dati),	// DMA wishbone data in
+		.xip_own(xip_own),		// XIP owns spi0 pins
+		.xip_cs_n(xip_cs_n),	// XIP flash cs
+		.xip_sclk(xip_sclk),	// XIP flash sclk
+		.xip_mosi(xip_mosi),	// XIP flash mosi
+		.xip_mosi_oe(xip_mosi_oe),	// XIP mosi output enable
+		.xip_io0(xip_io0),		// XIP flash IO0 in
+		.xip_miso(xip_miso),	// XIP flash miso
+		.spi0_free(spi0_free),	// spi core 0 idle
+		.lcd_own(LCD_FABRIC),	// fabric LCD owns spi1 pins
+		.lcd_cs_n(lcd_cs_n),	// fabric LCD cs
+		.lcd_sclk(lcd_sclk),	// fabric LCD sclk
+		.lcd_mosi(lcd_mosi),	// fabric LCD mosi
+		.spi0_irq(spi0_irq),	// spi core 0 irq
+		.spi1_irq(spi1_irq),	// spi core 1 irq
+		.i2c0_irq(i2c0_irq),	// i2c core 0 irq
+		.i2c1_irq(i2c1_irq),	// i2c core 1 irq
 		.spi0_mosi(spi0_mosi),	// spi core 0 mosi
 		.spi0_miso(spi0_miso),	// spi core 0 miso
 		.spi0_sclk(spi0_sclk),	// spi core 0 sclk
 		.spi0_cs0(spi0_cs0),	// spi core 0 cs
+		.spi0_cs1(spi0_cs1),	// spi core 0 extra cs
+		.spi0_cs2(spi0_cs2),
+		.spi0_cs3(spi0_cs3),
 		.spi1_mosi(spi1_mosi),	// spi core 1 mosi
 		.spi1_miso(spi1_miso),	// spi core 1 miso
 		.spi1_sclk(spi1_sclk),	// spi core 1 sclk
 		.spi1_cs0(spi1_cs0),	// spi core 1 cs
+		.spi1_cs1(spi1_cs1),	// spi core 1 extra cs
+		.spi1_cs2(spi1_cs2),
+		.spi1_cs3(spi1_cs3),
 		.i2c0_sda(i2c0_sda),	// i2c core 0 data
-		.i2c0_scl(i2c0_scl)		// i2c core 0 clk
+		.i2c0_scl(i2c0_scl),	// i2c core 0 clk
+		.i2c1_sda(i2c1_sda),	// i2c core 1 data
+		.i2c1_scl(i2c1_scl)		// i2c core 1 clk
 	);
 	
-	// Resettable clock counter
-	reg [31:0] cnt;
-	always @(posedge clk24)
-		if(cnt_sel & |mem_wstrb)
-		begin
-			if(mem_wstrb[0])
-				cnt[7:0] <= mem_wdata[7:0];
-			if(mem_wstrb[1])
-				cnt[15:8] <= mem_wdata[15:8];
-			if(mem_wstrb[2])
-				cnt[23:16] <= mem_wdata[23:16];
-			if(mem_wstrb[3])
-				cnt[31:24] <= mem_wdata[31:24];
-		end
-		else
-			cnt <= cnt + 32'd1;
+	// Free-running timer with compare channels
+	wire [31:0] cnt_do;
+	wire tmr_irq;
+	timer utimer(
+		.clk(clk24),			// system clock
+		.rst(reset),			// system reset
+		.cs(cnt_sel),			// chip select
+		.we(|mem_wstrb),		// write enable
+		.addr(mem_addr[5:2]),	// register select
+		.din(mem_wdata),		// data bus input
+		.dout(cnt_do),			// data bus output
+		.irq(tmr_irq)			// high-true interrupt request
+	);
+	
+	// Interrupt controller
+	wire [31:0] int_do;
+	intc uintc(
+		.clk(clk24),			// system clock
+		.rst(reset),			// system reset
+		.cs(int_sel),			// chip select
+		.we(|mem_wstrb),		// write enable
+		.addr(mem_addr[3:2]),	// register select
+		.din(mem_wdata),		// data bus input
+		.dout(int_do),			// data bus output
+		.src({					// sources, see irq.h
+			1'b0,
+			i2c1_irq,			// 6
+			dma_irq,			// 5
+			tmr_irq,			// 4
+			i2c0_irq,			// 3
+			spi1_irq,			// 2
+			spi0_irq,			// 1
+			ser_irq				// 0
+		}),
+		.irq(intc_irq)			// to CPU
+	);
 	
 	// Read Mux
 	always @(*)
-		casex({cnt_sel,wbb_sel,ser_sel,gpo_sel,ram_sel,rom_sel})
-			6'b000001: mem_rdata = rom_do;
-			6'b00001x: mem_rdata = ram_do;
-			6'b0001xx: mem_rdata = gp_out;
-			6'b001xxx: mem_rdata = {{24{1'b0}},ser_do};
-			6'b01xxxx: mem_rdata = {{24{1'b0}},wbb_do};
-			6'b1xxxxx: mem_rdata = cnt;
+		casex({lcd_sel,int_sel,xip_sel|xrg_sel|xst_sel,dma_sel,cnt_sel,wbb_sel,ser_sel,gpo_sel,ram_sel,rom_sel})
+			10'b0000000001: mem_rdata = rom_do;
+			10'b000000001x: mem_rdata = ram_do;
+			10'b00000001xx: mem_rdata = gp_out;
+			10'b0000001xxx: mem_rdata = {{24{1'b0}},ser_do};
+			10'b000001xxxx: mem_rdata = wbb_do;
+			10'b00001xxxxx: mem_rdata = cnt_do;
+			10'b0001xxxxxx: mem_rdata = dma_do;
+			10'b001xxxxxxx: mem_rdata = xip_do;
+			10'b01xxxxxxxx: mem_rdata = int_do;
+			10'b1xxxxxxxxx: mem_rdata = lcd_do;
 			default: mem_rdata = 32'd0;
 		endcase
 	
-	// ready flag
+	// ready flag - ROM & RAM are immediate with look-ahead
+	wire ramrom_sel = LA_MEM ? 1'b0 : (ram_sel|rom_sel);
+	wire la_rdy = LA_MEM ? (ram_sel|rom_sel) : 1'b0;
 	reg mem_rdy;
 	always @(posedge clk24)
 		if(reset)
 			mem_rdy <= 1'b0;
 		else
-			mem_rdy <= (cnt_sel|ser_sel|gpo_sel|ram_sel|rom_sel) & ~mem_rdy;
-	assign mem_ready = wbb_rdy | mem_rdy;
+			mem_rdy <= (lcd_sel|int_sel|dma_sel|cnt_sel|ser_sel|gpo_sel|ramrom_sel) & ~mem_rdy;
+	assign mem_ready = la_rdy | xip_rdy | wbb_rdy | mem_rdy;
 
 endmodule
 
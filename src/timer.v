@@ -0,0 +1,106 @@
+// timer.v - free-running 64-bit cycle counter with compare channels
+// 10-17-26 E. Brombaugh
+//
+// The counter is never written so any number of users can timestamp and
+// delay against it. Each compare channel fires once when the low word
+// passes its compare value (signed difference, so deadlines up to 2^31
+// clocks ahead work across wrap) and then disarms itself.
+//
+// Register map (32-bit, word offsets):
+//  0 CNTLO  - R: counter bits 31:0, latches bits 63:32 into CNTHI
+//  1 CNTHI  - R: counter bits 63:32 as of the last CNTLO read
+//  2 PEND   - R: channels that have fired. W: 1 acks (clears) pending bits
+//  3 ARM    - R: armed channels. W: 1 arms channel
+//  4 DISARM - W: 1 disarms channel
+//  5 IE     - R/W: per-channel interrupt enables
+//  8+n CMPn - R/W: compare value for channel n
+
+`default_nettype none
+
+module timer(
+	input clk,					// system clock
+	input rst,					// system reset
+	input cs,					// chip select
+	input we,					// write enable
+	input [3:0] addr,			// register select
+	input [31:0] din,			// data bus input
+	output reg [31:0] dout,		// data bus output
+	output irq					// high-true interrupt request
+);
+	parameter NCH = 4;			// compare channels, 4 max
+
+	// bus cycles last more than one clock so only act on the first
+	reg cs_d;
+	always @(posedge clk)
+		cs_d <= cs;
+	wire acc = cs & ~cs_d;
+	wire wr = acc & we;
+
+	// free-running counter
+	reg [63:0] cnt;
+	always @(posedge clk)
+		if(rst)
+			cnt <= 64'd0;
+		else
+			cnt <= cnt + 64'd1;
+
+	// compare values
+	reg [31:0] cmp[0:NCH-1];
+	always @(posedge clk)
+		if(wr & (addr[3:2] == 2'b10))
+			cmp[addr[1:0]] <= din;
+
+	// match when counter has reached compare on an armed channel
+	reg [NCH-1:0] arm;
+	wire [NCH-1:0] match;
+	genvar i;
+	generate
+		for(i=0;i<NCH;i=i+1)
+		begin: chan
+			wire [31:0] diff = cnt[31:0] - cmp[i];
+			assign match[i] = arm[i] & ~diff[31];
+		end
+	endgenerate
+
+	// arm, pending & enables
+	reg [NCH-1:0] pend, ie;
+	wire [NCH-1:0] ack = (wr & (addr == 4'd2)) ? din[NCH-1:0] : {NCH{1'b0}};
+	wire [NCH-1:0] set = (wr & (addr == 4'd3)) ? din[NCH-1:0] : {NCH{1'b0}};
+	wire [NCH-1:0] clr = (wr & (addr == 4'd4)) ? din[NCH-1:0] : {NCH{1'b0}};
+	always @(posedge clk)
+		if(rst)
+		begin
+			arm <= {NCH{1'b0}};
+			pend <= {NCH{1'b0}};
+			ie <= {NCH{1'b0}};
+		end
+		else
+		begin
+			arm <= (arm & ~match & ~clr) | set;
+			pend <= (pend & ~ack) | match;
+
+			if(wr & (addr == 4'd5))
+				ie <= din[NCH-1:0];
+		end
+
+	// register readback - high word snapshot keeps 64-bit reads coherent
+	reg [31:0] cnt_hi;
+	always @(posedge clk)
+		if(acc & ~we)
+			casex(addr)
+				4'b0000:
+				begin
+					dout <= cnt[31:0];
+					cnt_hi <= cnt[63:32];
+				end
+				4'b0001: dout <= cnt_hi;
+				4'b0010: dout <= {{32-NCH{1'b0}},pend};
+				4'b0011: dout <= {{32-NCH{1'b0}},arm};
+				4'b0101: dout <= {{32-NCH{1'b0}},ie};
+				4'b10xx: dout <= cmp[addr[1:0]];
+				default: dout <= 32'd0;
+			endcase
+
+	assign irq = |(pend & ie);
+
+endmodule
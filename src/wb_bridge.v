@@ -0,0 +1,228 @@
+// wb_bridge.v - 32-bit CPU to 8-bit SB wishbone bridge with posted writes
+// 10-17-26 E. Brombaugh
+//
+// Writes are acked in the same cycle and queued, so the CPU only stalls
+// when the queue is full. Each byte lane of a write becomes a wishbone
+// write to consecutive SB registers, so one 32-bit store can load four
+// registers. Reads wait for queued writes to drain to keep ordering and
+// return ready directly from the SB ACK. Queued cycles are issued with
+// a single idle clock between strobes.
+//
+// addr[8] selects the bridge's own counters (32-bit, word offsets):
+//  0 CTRL   - W: clear all counters
+//  1 WRCNT  - wishbone write cycles
+//  2 WRCYC  - clocks spent in wishbone write cycles
+//  3 RDCNT  - CPU reads
+//  4 RDCYC  - clocks CPU reads waited, including queue drain
+//  5 STALL  - clocks CPU writes waited on a full queue
+//  6 MAXLAT - [31:16] longest write cycle, [15:0] longest read wait
+//  7 TMO    - cycles ended by timeout
+
+`default_nettype none
+
+module wb_bridge(
+	input clk,					// system clock
+	input rst,					// system reset
+	input cs,					// chip select
+	input [3:0] we,				// byte write enables
+	input [8:0] addr,			// [8] counters, [7:0] SB register
+	input [31:0] din,			// data bus input
+	output [31:0] dout,			// data bus output
+	output rdy,					// high-true ready flag
+	output wb_req,				// bridge has cycles to run
+
+	output reg wb_stbo,			// wishbone STB
+	output reg [7:0] wb_adro,	// wishbone Address
+	output reg wb_rwo,			// wishbone read/write
+	output reg [7:0] wb_dato,	// wishbone data out
+	input wb_acki,				// wishbone ACK
+	input [7:0] wb_dati			// wishbone data in
+);
+	parameter QW = 2;			// log2 of posted write queue depth
+	parameter [4:0] TIMEOUT = 5'd15;	// clocks to wait for ACK
+
+	wire reg_sel = cs & addr[8];
+	wire sb_wr = cs & ~addr[8] & |we;
+	wire sb_rd = cs & ~addr[8] & ~|we;
+
+	// posted write queue of {addr, lanes, data}
+	reg [43:0] q[0:(1<<QW)-1];
+	reg [QW-1:0] q_wp, q_rp;
+	reg [QW:0] q_lvl;
+	wire q_empty = ~|q_lvl;
+	wire q_full = q_lvl[QW];
+	wire q_push = sb_wr & ~q_full;
+	wire q_pop;
+	always @(posedge clk)
+		if(q_push)
+			q[q_wp] <= {addr[7:0],we,din};
+
+	always @(posedge clk)
+		if(rst)
+		begin
+			q_wp <= {QW{1'b0}};
+			q_rp <= {QW{1'b0}};
+			q_lvl <= {QW+1{1'b0}};
+		end
+		else
+		begin
+			if(q_push)
+				q_wp <= q_wp + 1;
+			if(q_pop)
+				q_rp <= q_rp + 1;
+			q_lvl <= q_lvl + {{QW{1'b0}},q_push} - {{QW{1'b0}},q_pop};
+		end
+
+	wire [7:0] h_adr = q[q_rp][43:36];
+	wire [3:0] h_lanes = q[q_rp][35:32];
+	wire [31:0] h_dat = q[q_rp][31:0];
+
+	// lowest lane still to write
+	function [1:0] first;
+		input [3:0] m;
+		first = m[0] ? 2'd0 : m[1] ? 2'd1 : m[2] ? 2'd2 : 2'd3;
+	endfunction
+
+	// wishbone cycles
+	localparam S_IDLE = 2'd0, S_WR = 2'd1, S_RD = 2'd2;
+	reg [1:0] state;
+	reg [3:0] cur;				// lanes left in head entry
+	reg cont;					// head entry partly written
+	reg [4:0] tmo;
+	wire [3:0] lanes = cont ? cur : h_lanes;
+	wire [1:0] ln = first(lanes);
+	wire [31:0] h_byte = h_dat >> {ln,3'b000};
+	wire done = wb_acki | ~|tmo;
+	always @(posedge clk)
+		if(rst)
+		begin
+			state <= S_IDLE;
+			cur <= 4'h0;
+			cont <= 1'b0;
+			tmo <= 5'd0;
+			wb_stbo <= 1'b0;
+			wb_adro <= 8'h00;
+			wb_rwo <= 1'b1;
+			wb_dato <= 8'h00;
+		end
+		else
+			case(state)
+				S_IDLE:
+					if(cont | ~q_empty)
+					begin
+						// queued writes go first so reads see them
+						wb_stbo <= 1'b1;
+						wb_rwo <= 1'b1;
+						wb_adro <= h_adr + {6'd0,ln};
+						wb_dato <= h_byte[7:0];
+						cur <= lanes & ~(4'b0001 << ln);
+						tmo <= TIMEOUT;
+						state <= S_WR;
+					end
+					else if(sb_rd)
+					begin
+						wb_stbo <= 1'b1;
+						wb_rwo <= 1'b0;
+						wb_adro <= addr[7:0];
+						tmo <= TIMEOUT;
+						state <= S_RD;
+					end
+
+				S_WR:
+				begin
+					tmo <= tmo - 5'd1;
+					if(done)
+					begin
+						wb_stbo <= 1'b0;
+						cont <= |cur;
+						state <= S_IDLE;
+					end
+				end
+
+				S_RD:
+				begin
+					tmo <= tmo - 5'd1;
+					if(done)
+					begin
+						wb_stbo <= 1'b0;
+						state <= S_IDLE;
+					end
+				end
+
+				default:
+					state <= S_IDLE;
+			endcase
+
+	assign q_pop = (state == S_WR) & done & ~|cur;
+	wire rd_rdy = (state == S_RD) & done;
+	assign wb_req = ~q_empty | cont | (state != S_IDLE) | sb_rd;
+
+	// latency counters
+	reg [31:0] wr_cnt, wr_cyc, rd_cnt, rd_cyc, stall, tmo_cnt;
+	reg [15:0] wr_lat, rd_lat, wr_max, rd_max;
+	wire clr = reg_sel & |we & (addr[2:0] == 3'd0);
+	always @(posedge clk)
+		if(rst | clr)
+		begin
+			wr_cnt <= 32'd0;
+			wr_cyc <= 32'd0;
+			rd_cnt <= 32'd0;
+			rd_cyc <= 32'd0;
+			stall <= 32'd0;
+			tmo_cnt <= 32'd0;
+			wr_lat <= 16'd0;
+			rd_lat <= 16'd0;
+			wr_max <= 16'd0;
+			rd_max <= 16'd0;
+		end
+		else
+		begin
+			if(state == S_WR)
+			begin
+				wr_cyc <= wr_cyc + 32'd1;
+				wr_lat <= done ? 16'd0 : wr_lat + 16'd1;
+				if(done)
+				begin
+					wr_cnt <= wr_cnt + 32'd1;
+					if(wr_lat + 16'd1 > wr_max)
+						wr_max <= wr_lat + 16'd1;
+				end
+			end
+
+			if(sb_rd)
+			begin
+				rd_cyc <= rd_cyc + 32'd1;
+				rd_lat <= rd_rdy ? 16'd0 : rd_lat + 16'd1;
+				if(rd_rdy)
+				begin
+					rd_cnt <= rd_cnt + 32'd1;
+					if(rd_lat + 16'd1 > rd_max)
+						rd_max <= rd_lat + 16'd1;
+				end
+			end
+
+			if(sb_wr & q_full)
+				stall <= stall + 32'd1;
+
+			if((state != S_IDLE) & ~wb_acki & ~|tmo)
+				tmo_cnt <= tmo_cnt + 32'd1;
+		end
+
+	// counter readback
+	reg [31:0] reg_do;
+	always @(*)
+		case(addr[2:0])
+			3'd1: reg_do = wr_cnt;
+			3'd2: reg_do = wr_cyc;
+			3'd3: reg_do = rd_cnt;
+			3'd4: reg_do = rd_cyc;
+			3'd5: reg_do = stall;
+			3'd6: reg_do = {wr_max,rd_max};
+			3'd7: reg_do = tmo_cnt;
+			default: reg_do = 32'd0;
+		endcase
+
+	assign dout = addr[8] ? reg_do : {24'd0,wb_dati};
+	assign rdy = q_push | rd_rdy | reg_sel;
+
+endmodule
@@ -7,27 +7,82 @@ module wb_bus(
 	input clk,				// system clock
 	input rst,				// system reset
 	input cs,				// chip select
-	input we,				// write enable
-	input [7:0] addr,		// register select
-	input [7:0] din,		// data bus input
-	output [7:0] dout,		// data bus output
+	input [3:0] we,			// byte write enables
+	input [8:0] addr,		// register select
+	input [31:0] din,		// data bus input
+	output [31:0] dout,		// data bus output
 	output rdy,				// high-true ready flag
+	input dma_stb,			// DMA wishbone STB
+	input [7:0] dma_adr,	// DMA wishbone Address
+	input dma_rw,			// DMA wishbone read/write
+	input [7:0] dma_dat,	// DMA wishbone data out
+	output dma_ack,			// DMA wishbone ACK
+	output [7:0] dma_dati,	// DMA wishbone data in
+	input xip_own,			// XIP reader owns spi0 pins
+	input xip_cs_n,			// XIP flash cs
+	input xip_sclk,			// XIP flash sclk
+	input xip_mosi,			// XIP flash mosi
+	input xip_mosi_oe,		// XIP drives mosi
+	output xip_io0,			// XIP flash IO0 in
+	output xip_miso,		// XIP flash miso
+	output spi0_free,		// spi core 0 cs inactive
+	input lcd_own,			// fabric LCD master owns spi1 pins
+	input lcd_cs_n,			// fabric LCD cs
+	input lcd_sclk,			// fabric LCD sclk
+	input lcd_mosi,			// fabric LCD mosi
+	output spi0_irq,		// spi core 0 interrupt
+	output spi1_irq,		// spi core 1 interrupt
+	output i2c0_irq,		// i2c core 0 interrupt
+	output i2c1_irq,		// i2c core 1 interrupt
 	inout spi0_mosi,		// spi core 0 mosi
 	inout spi0_miso,		// spi core 0 miso
 	inout spi0_sclk,		// spi core 0 sclk
 	inout spi0_cs0,			// spi core 0 cs
+	output spi0_cs1,		// spi core 0 extra cs
+	output spi0_cs2,
+	output spi0_cs3,
 	inout spi1_mosi,		// spi core 1 mosi
 	inout spi1_miso,		// spi core 1 miso
 	inout spi1_sclk,		// spi core 1 sclk
 	inout spi1_cs0,			// spi core 1 cs
+	output spi1_cs1,		// spi core 1 extra cs
+	output spi1_cs2,
+	output spi1_cs3,
 	inout i2c0_sda,			// i2c core 0 data
-	inout i2c0_scl			// i2c core 0 clock
+	inout i2c0_scl,			// i2c core 0 clock
+	inout i2c1_sda,			// i2c core 1 data
+	inout i2c1_scl			// i2c core 1 clock
 );
 
-	// the wishbone master
+	// the wishbone master - posted-write bridge or original 8-bit master
+	wire cpu_stb, cpu_rw, cpu_ack, cpu_req;
+	wire [7:0] cpu_adr, cpu_dat;
 	wire sbstbi, sbrwi, sbacko;
 	wire [7:0] sbadri, sbdato, sbdati;
+`ifdef WB_LEGACY
+	wire [7:0] cpu_do;
+	wire cpu_rdy;
 	wb_master uwbm(
+		.clk(clk),
+		.rst(rst),
+		.cs(cs & ~addr[8]),
+		.we(we[0]),
+		.addr(addr[7:0]),
+		.din(din[7:0]),
+		.dout(cpu_do),
+		.rdy(cpu_rdy),
+		.wb_stbo(cpu_stb),
+		.wb_adro(cpu_adr),
+		.wb_rwo(cpu_rw),
+		.wb_dato(cpu_dat),
+		.wb_acki(cpu_ack),
+		.wb_dati(sbdato)
+	);
+	assign dout = {24'd0,cpu_do};
+	assign rdy = cpu_rdy | (cs & addr[8]);	// no counters
+	assign cpu_req = cpu_stb;
+`else
+	wb_bridge uwbm(
 		.clk(clk),
 		.rst(rst),
 		.cs(cs),
@@ -36,19 +91,48 @@ module wb_bus(
 		.din(din),
 		.dout(dout),
 		.rdy(rdy),
-		.wb_stbo(sbstbi),
-		.wb_adro(sbadri),
-		.wb_rwo(sbrwi),
-		.wb_dato(sbdati),
-		.wb_acki(sbacko),
+		.wb_req(cpu_req),
+		.wb_stbo(cpu_stb),
+		.wb_adro(cpu_adr),
+		.wb_rwo(cpu_rw),
+		.wb_dato(cpu_dat),
+		.wb_acki(cpu_ack),
 		.wb_dati(sbdato)
 	);
+`endif
+	
+	// arbitrate between CPU and DMA masters. Ownership only changes
+	// between cycles and the CPU wins while it has anything queued, so
+	// posted writes stay ahead of DMA cycles started after them. DMA
+	// cycles are a few clocks so the CPU master's timeout is not reached
+	// while waiting.
+	reg dma_own;
+	wire own_stb = dma_own ? dma_stb : cpu_stb;
+	always @(posedge clk)
+		if(rst)
+			dma_own <= 1'b0;
+		else if(!own_stb)
+		begin
+			if(cpu_req)
+				dma_own <= 1'b0;
+			else if(dma_stb)
+				dma_own <= 1'b1;
+		end
+	
+	assign sbstbi = own_stb;
+	assign sbadri = dma_own ? dma_adr : cpu_adr;
+	assign sbrwi = dma_own ? dma_rw : cpu_rw;
+	assign sbdati = dma_own ? dma_dat : cpu_dat;
+	assign cpu_ack = sbacko & ~dma_own;
+	assign dma_ack = sbacko & dma_own;
+	assign dma_dati = sbdato;
 	
 	// SPI IP Core 0
 	wire moe_0, mo_0, si_0;			// MOSI components
 	wire soe_0, mi_0, so_0;			// MISO components
 	wire sckoe_0, scko_0, scki_0;	// SCLK components
 	wire mcsnoe_00, mcsno_00, scsni_0;		// CS0 components
+	wire mcsno_10, mcsno_20, mcsno_30;		// CS1-3
 	wire [7:0] sbdato_0;
 	wire sbacko_0;
 	SB_SPI #(
@@ -87,7 +171,7 @@ module wb_bus(
 		.SBDATO1(sbdato_0[1]),
 		.SBDATO0(sbdato_0[0]),
 		.SBACKO(sbacko_0),
-		.SPIIRQ(),
+		.SPIIRQ(spi0_irq),
 		.SPIWKUP(),
 		.SO(so_0),
 		.SOE(soe_0),
@@ -95,9 +179,9 @@ module wb_bus(
 		.MOE(moe_0),
 		.SCKO(scko_0),
 		.SCKOE(sckoe_0),
-		.MCSNO3(),
-		.MCSNO2(),
-		.MCSNO1(),
+		.MCSNO3(mcsno_30),
+		.MCSNO2(mcsno_20),
+		.MCSNO1(mcsno_10),
 		.MCSNO0(mcsno_00),
 		.MCSNOE3(),
 		.MCSNOE2(),
@@ -105,6 +189,11 @@ module wb_bus(
 		.MCSNOE0(mcsnoe_00)
 	);
 	
+	// XIP reader shares the flash pins when the SB core is idle
+	assign spi0_free = mcsno_00 & mcsno_10 & mcsno_20 & mcsno_30;
+	assign xip_miso = mi_0;
+	assign xip_io0 = si_0;
+	
 	// I/O drivers are tri-state output w/ simple input
 	// MOSI driver
 	SB_IO #(
@@ -118,8 +207,8 @@ module wb_bus(
 		.CLOCK_ENABLE(1'b0),
 		.INPUT_CLK(1'b0),
 		.OUTPUT_CLK(1'b0),
-		.OUTPUT_ENABLE(moe_0),
-		.D_OUT_0(mo_0),
+		.OUTPUT_ENABLE(xip_own ? xip_mosi_oe : moe_0),
+		.D_OUT_0(xip_own ? xip_mosi : mo_0),
 		.D_OUT_1(1'b0),
 		.D_IN_0(si_0),
 		.D_IN_1()
@@ -156,8 +245,8 @@ module wb_bus(
 		.CLOCK_ENABLE(1'b0),
 		.INPUT_CLK(1'b0),
 		.OUTPUT_CLK(1'b0),
-		.OUTPUT_ENABLE(sckoe_0),
-		.D_OUT_0(scko_0),
+		.OUTPUT_ENABLE(xip_own | sckoe_0),
+		.D_OUT_0(xip_own ? xip_sclk : scko_0),
 		.D_OUT_1(1'b0),
 		.D_IN_0(scki_0),
 		.D_IN_1()
@@ -176,17 +265,25 @@ module wb_bus(
 		.INPUT_CLK(1'b0),
 		.OUTPUT_CLK(1'b0),
 		.OUTPUT_ENABLE(1'b1),	// or mcsnoe_00 for hi-z when inactive
-		.D_OUT_0(mcsno_00),
+		.D_OUT_0(xip_own ? xip_cs_n : mcsno_00),
 		.D_OUT_1(1'b0),
 		.D_IN_0(scsni_0),		// unused to prevent accidental slave mode
 		.D_IN_1()
 	);
 	
-	// SPI IP Core 1
+	// CS1-3 are outputs only, always driven
+	assign spi0_cs1 = mcsno_10;
+	assign spi0_cs2 = mcsno_20;
+	assign spi0_cs3 = mcsno_30;
+	
+	// SPI IP Core 1 - the fabric LCD master only takes SCLK & MOSI while
+	// its CS is active so SB_SPI1 can reach devices on CS1-3 in between
+	wire lcd_act = lcd_own & ~lcd_cs_n;
 	wire moe_1, mo_1, si_1;			// MOSI components
 	wire soe_1, mi_1, so_1;			// MISO components
 	wire sckoe_1, scko_1, scki_1;	// SCLK components
 	wire mcsnoe_01, mcsno_01, scsni_1;		// CS0 components
+	wire mcsno_11, mcsno_21, mcsno_31;		// CS1-3
 	wire [7:0] sbdato_1;
 	wire sbacko_1;
 	SB_SPI #(
@@ -225,7 +322,7 @@ module wb_bus(
 		.SBDATO1(sbdato_1[1]),
 		.SBDATO0(sbdato_1[0]),
 		.SBACKO(sbacko_1),
-		.SPIIRQ(),
+		.SPIIRQ(spi1_irq),
 		.SPIWKUP(),
 		.SO(so_1),
 		.SOE(soe_1),
@@ -233,9 +330,9 @@ module wb_bus(
 		.MOE(moe_1),
 		.SCKO(scko_1),
 		.SCKOE(sckoe_1),
-		.MCSNO3(),
-		.MCSNO2(),
-		.MCSNO1(),
+		.MCSNO3(mcsno_31),
+		.MCSNO2(mcsno_21),
+		.MCSNO1(mcsno_11),
 		.MCSNO0(mcsno_01),
 		.MCSNOE3(),
 		.MCSNOE2(),
@@ -256,8 +353,8 @@ module wb_bus(
 		.CLOCK_ENABLE(1'b0),
 		.INPUT_CLK(1'b0),
 		.OUTPUT_CLK(1'b0),
-		.OUTPUT_ENABLE(moe_1),
-		.D_OUT_0(mo_1),
+		.OUTPUT_ENABLE(lcd_act | moe_1),
+		.D_OUT_0(lcd_act ? lcd_mosi : mo_1),
 		.D_OUT_1(1'b0),
 		.D_IN_0(si_1),
 		.D_IN_1()
@@ -294,8 +391,8 @@ module wb_bus(
 		.CLOCK_ENABLE(1'b0),
 		.INPUT_CLK(1'b0),
 		.OUTPUT_CLK(1'b0),
-		.OUTPUT_ENABLE(sckoe_1),
-		.D_OUT_0(scko_1),
+		.OUTPUT_ENABLE(lcd_act | sckoe_1),
+		.D_OUT_0(lcd_act ? lcd_sclk : scko_1),
 		.D_OUT_1(1'b0),
 		.D_IN_0(scki_1),
 		.D_IN_1()
@@ -314,12 +411,17 @@ module wb_bus(
 		.INPUT_CLK(1'b0),
 		.OUTPUT_CLK(1'b0),
 		.OUTPUT_ENABLE(1'b1),	// or mcsnoe_00 for hi-z when inactive
-		.D_OUT_0(mcsno_01),
+		.D_OUT_0(lcd_own ? lcd_cs_n : mcsno_01),
 		.D_OUT_1(1'b0),
 		.D_IN_0(scsni_1),		// unused to prevent accidental slave mode
 		.D_IN_1()
 	);
 	
+	// CS1-3 are outputs only, always driven
+	assign spi1_cs1 = mcsno_11;
+	assign spi1_cs2 = mcsno_21;
+	assign spi1_cs3 = mcsno_31;
+	
 	// I2C IP Core
 	wire sda_oe_0, sda_i_0, sda_o_0;			// sda components
 	wire scl_oe_0, scl_i_0, scl_o_0;			// scl components
@@ -359,7 +461,7 @@ module wb_bus(
 		.SBDATO1(sbdato_2[1]),
 		.SBDATO0(sbdato_2[0]),
 		.SBACKO(sbacko_2),
-		.I2CIRQ(),
+		.I2CIRQ(i2c0_irq),
 		.I2CWKUP(),
 		.SCLO(scl_o_0),
 		.SCLOE(scl_oe_0),
@@ -406,7 +508,92 @@ module wb_bus(
 		.D_IN_1()
 	);
 	
+	// I2C IP Core 1
+	wire sda_oe_1, sda_i_1, sda_o_1;			// sda components
+	wire scl_oe_1, scl_i_1, scl_o_1;			// scl components
+	wire [7:0] sbdato_3;
+	wire sbacko_3;
+	SB_I2C #(
+		.BUS_ADDR74("0b0011")
+	) 
+	i2cInst1 (
+		.SBCLKI(clk),
+		.SBRWI(sbrwi),
+		.SBSTBI(sbstbi),
+		.SBADRI7(sbadri[7]),
+		.SBADRI6(sbadri[6]),
+		.SBADRI5(sbadri[5]),
+		.SBADRI4(sbadri[4]),
+		.SBADRI3(sbadri[3]),
+		.SBADRI2(sbadri[2]),
+		.SBADRI1(sbadri[1]),
+		.SBADRI0(sbadri[0]),
+		.SBDATI7(sbdati[7]),
+		.SBDATI6(sbdati[6]),
+		.SBDATI5(sbdati[5]),
+		.SBDATI4(sbdati[4]),
+		.SBDATI3(sbdati[3]),
+		.SBDATI2(sbdati[2]),
+		.SBDATI1(sbdati[1]),
+		.SBDATI0(sbdati[0]),
+		.SCLI(scl_i_1),
+		.SDAI(sda_i_1),
+		.SBDATO7(sbdato_3[7]),
+		.SBDATO6(sbdato_3[6]),
+		.SBDATO5(sbdato_3[5]),
+		.SBDATO4(sbdato_3[4]),
+		.SBDATO3(sbdato_3[3]),
+		.SBDATO2(sbdato_3[2]),
+		.SBDATO1(sbdato_3[1]),
+		.SBDATO0(sbdato_3[0]),
+		.SBACKO(sbacko_3),
+		.I2CIRQ(i2c1_irq),
+		.I2CWKUP(),
+		.SCLO(scl_o_1),
+		.SCLOE(scl_oe_1),
+		.SDAO(sda_o_1),
+		.SDAOE(sda_oe_1)
+	);
+	
+	// SDA driver
+	SB_IO #(
+		.PIN_TYPE(6'b101001),
+		.PULLUP(1'b1),
+		.NEG_TRIGGER(1'b0),
+		.IO_STANDARD("SB_LVCMOS")
+	) usda1 (
+		.PACKAGE_PIN(i2c1_sda),
+		.LATCH_INPUT_VALUE(1'b0),
+		.CLOCK_ENABLE(1'b0),
+		.INPUT_CLK(1'b0),
+		.OUTPUT_CLK(1'b0),
+		.OUTPUT_ENABLE(sda_oe_1),
+		.D_OUT_0(sda_o_1),
+		.D_OUT_1(1'b0),
+		.D_IN_0(sda_i_1),
+		.D_IN_1()
+	);
+	
+	// SCL driver
+	SB_IO #(
+		.PIN_TYPE(6'b101001),
+		.PULLUP(1'b1),
+		.NEG_TRIGGER(1'b0),
+		.IO_STANDARD("SB_LVCMOS")
+	) uscl1 (
+		.PACKAGE_PIN(i2c1_scl),
+		.LATCH_INPUT_VALUE(1'b0),
+		.CLOCK_ENABLE(1'b0),
+		.INPUT_CLK(1'b0),
+		.OUTPUT_CLK(1'b0),
+		.OUTPUT_ENABLE(scl_oe_1),
+		.D_OUT_0(scl_o_1),
+		.D_OUT_1(1'b0),
+		.D_IN_0(scl_i_1),
+		.D_IN_1()
+	);
+	
 	// OR muxing of output data & ack
-	assign sbdato = sbdato_0 | sbdato_1 | sbdato_2;
-	assign sbacko = sbacko_0 | sbacko_1 | sbacko_2;
+	assign sbdato = sbdato_0 | sbdato_1 | sbdato_2 | sbdato_3;
+	assign sbacko = sbacko_0 | sbacko_1 | sbacko_2 | sbacko_3;
 endmodule
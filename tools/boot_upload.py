@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# boot_upload.py - send a SPRAM image to the up5k_riscv serial bootloader
+# 10-17-26 E. Brombaugh
+#
+# Protocol and limits are in c/boot.h. Reset the board after starting this
+# so the bootloader sees the sync frames in its wait window.
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+BOOT_BAUD = 115200
+APP_MAX = 0xF000
+BLK_RAW = 1024
+ACK = 0x06
+NAK = 0x15
+FL_SAVE = 0x0001
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT as in boot.c"""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+        crc &= 0xFFFF
+    return crc
+
+
+def lzss_block(img, start, end):
+    """pack img[start:end], matches may reach back before start"""
+    out = bytearray()
+    heads = {}
+    # seed the hash with the window before this block
+    for i in range(max(0, start - 4096), start):
+        heads.setdefault(bytes(img[i:i + 3]), []).append(i)
+    pos = start
+    while pos < end:
+        flag_at = len(out)
+        out.append(0)
+        for bit in range(8):
+            if pos >= end:
+                break
+            best_len, best_off = 0, 0
+            maxlen = min(18, end - pos)
+            if maxlen >= 3:
+                for cand in reversed(heads.get(bytes(img[pos:pos + 3]), [])):
+                    off = pos - cand
+                    if off > 4096:
+                        break
+                    n = 3
+                    while n < maxlen and img[cand + n] == img[pos + n]:
+                        n += 1
+                    if n > best_len:
+                        best_len, best_off = n, off
+                        if n == maxlen:
+                            break
+            if best_len >= 3:
+                o = best_off - 1
+                out += bytes([o & 0xFF, ((o >> 4) & 0xF0) | (best_len - 3)])
+                step = best_len
+            else:
+                out[flag_at] |= 1 << bit
+                out.append(img[pos])
+                step = 1
+            for i in range(pos, pos + step):
+                heads.setdefault(bytes(img[i:i + 3]), []).append(i)
+            pos += step
+    return bytes(out)
+
+
+class Loader:
+    def __init__(self, port):
+        self.ser = serial.Serial(port, BOOT_BAUD, timeout=0.2)
+
+    def frame(self, cmd, payload=b"", timeout=0.5, tries=10):
+        """send a frame until it's ACKed"""
+        hdr = bytes([ord(cmd)]) + struct.pack("<H", len(payload))
+        body = hdr + payload
+        frm = body + struct.pack("<H", crc16(body))
+        for _ in range(tries):
+            self.ser.reset_input_buffer()
+            self.ser.write(frm)
+            t = time.time() + timeout
+            while time.time() < t:
+                r = self.ser.read(1)
+                if r and r[0] == ACK:
+                    return True
+                if r and r[0] == NAK:
+                    break
+        return False
+
+    def sync(self, wait):
+        t = time.time() + wait
+        while time.time() < t:
+            if self.frame("S", timeout=0.05, tries=1):
+                return True
+        return False
+
+    def baud(self, rate):
+        if not self.frame("B", struct.pack("<I", rate)):
+            return False
+        self.ser.flush()
+        time.sleep(0.01)
+        self.ser.baudrate = rate
+        return self.sync(1.0)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__)
+    ap.add_argument("image", help="raw SPRAM image (c/main_ram.bin)")
+    ap.add_argument("-p", "--port", default="/dev/ttyUSB0")
+    ap.add_argument("-b", "--baud", type=int, default=2000000,
+                    help="upload rate, up to 3000000")
+    ap.add_argument("-w", "--wait", type=float, default=10.0,
+                    help="seconds to wait for the bootloader")
+    ap.add_argument("--save", action="store_true",
+                    help="also save the image to flash for the next boot")
+    args = ap.parse_args()
+
+    img = open(args.image, "rb").read()
+    if not img or len(img) > APP_MAX:
+        sys.exit("image must be 1..%d bytes" % APP_MAX)
+
+    blocks = []
+    for o in range(0, len(img), BLK_RAW):
+        end = min(o + BLK_RAW, len(img))
+        blocks.append(struct.pack("<HH", len(blocks), end - o) +
+                      lzss_block(img, o, end))
+    packed = sum(len(b) - 4 for b in blocks)
+
+    ld = Loader(args.port)
+    print("waiting for bootloader on %s - reset the board" % args.port)
+    if not ld.sync(args.wait):
+        sys.exit("no bootloader")
+    if args.baud != BOOT_BAUD and not ld.baud(args.baud):
+        sys.exit("couldn't switch to %d baud" % args.baud)
+
+    t0 = time.time()
+    flags = FL_SAVE if args.save else 0
+    if not ld.frame("H", struct.pack("<IHH", len(img), crc16(img), flags)):
+        sys.exit("header refused")
+    for n, b in enumerate(blocks):
+        if not ld.frame("D", b):
+            sys.exit("block %d failed" % n)
+        print("\r%d/%d" % (n + 1, len(blocks)), end="", flush=True)
+    print()
+    if not ld.frame("G", timeout=10.0 if args.save else 0.5, tries=2):
+        sys.exit("image check failed")
+    dt = time.time() - t0
+    print("%d bytes (%d packed) in %.2fs at %d baud" %
+          (len(img), packed, dt, ld.ser.baudrate))
+
+
+if __name__ == "__main__":
+    main()
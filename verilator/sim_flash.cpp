@@ -0,0 +1,271 @@
+/*
+ * sim_flash.cpp - file-backed SPI flash model for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ *
+ * The same W25Q-style command set as icarus/spi_flash.v: READ (0x03), fast
+ * read (0x0B), dual output read (0x3B), SFDP (0x5A), status 1 (0x05),
+ * JEDEC ID (0x9F), wakeup (0xAB), WEN/WDI (0x06/0x04), page program (0x02)
+ * and 4k/32k/64k erase (0x20/0x52/0xD8), with the same scaled-down busy
+ * times. It is sampled once per system clock, which is enough because
+ * the SPI clocks run at clk/2 or slower.
+ *
+ * The image file is loaded at an offset, or at 0 if it is a whole flash
+ * image. save() writes the whole flash back, so programs and erases
+ * anywhere persist between runs and the file loads whole from then on.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sim_flash.h"
+
+#define FLASH_ID 0xEF4016
+#define T_PP 480		// clocks at 24MHz, as spi_flash.v
+#define T_SE 2400
+#define T_BE32 4800
+#define T_BE64 7200
+
+/*
+ * blank flash with the SFDP table spi_flash.v has
+ */
+SimFlash::SimFlash(uint32_t size) : mem(size, 0xff)
+{
+	uint32_t i, top = size*8 - 1;
+	const uint32_t tbl[][2] =
+	{
+		{0x00, 0x50444653},		// "SFDP"
+		{0x04, 0xFF000100},		// rev 1.0, 1 header
+		{0x08, 0x09010000},		// BFPT 1.0, 9 dwords
+		{0x0C, 0xFF000080},		// @ 0x80
+		{0x80, 0xFF8120E5},		// 1-1-2 only
+		{0x84, top},
+		{0x88, 0x00000000},		// no 1-4-4, 1-1-4
+		{0x8C, 0x00003B08},		// 1-1-2 0x3B, 8 dummy
+	};
+	
+	memset(sfdp, 0xff, sizeof(sfdp));
+	for(i=0;i<sizeof(tbl)/sizeof(tbl[0]);i++)
+		memcpy(&sfdp[tbl[i][0]], &tbl[i][1], 4);
+	
+	reads = programs = erases = 0;
+	dirty = false;
+	now = busy_end = 0;
+	sclk_d = false;
+	cs_d = true;
+	sr_in = cmd = 0;
+	sr_out = 0xff;
+	bits = addr = 0;
+	drive = dual = wel = ok = false;
+}
+
+/*
+ * load an image at addr, or at 0 if it's the size of the flash, and
+ * remember it for save()
+ */
+bool SimFlash::load(const char *name, uint32_t a)
+{
+	FILE *fp = fopen(name, "rb");
+	bool ok;
+	
+	if(!fp)
+		return false;
+	
+	fseek(fp, 0, SEEK_END);
+	if(ftell(fp) == (long)mem.size())
+		a = 0;
+	rewind(fp);
+	
+	file = name;
+	a %= mem.size();
+	ok = fread(&mem[a], 1, mem.size() - a, fp) || !ferror(fp);
+	fclose(fp);
+	return ok;
+}
+
+/*
+ * write the whole flash back to the image file if anything changed
+ */
+bool SimFlash::save(void)
+{
+	FILE *fp;
+	bool ok;
+	
+	if(!dirty || file.empty())
+		return true;
+	
+	if(!(fp = fopen(file.c_str(), "wb")))
+		return false;
+	ok = fwrite(&mem[0], 1, mem.size(), fp) == mem.size();
+	ok = (fclose(fp) == 0) && ok;
+	dirty = !ok;
+	return ok;
+}
+
+/*
+ * sample the pins after a system clock
+ */
+void SimFlash::tick(uint64_t clk, bool sclk, bool cs, bool mosi, bool &miso,
+	bool &io0, bool &io0_oe)
+{
+	now = clk;
+	
+	if(!cs && cs_d)
+	{
+		bits = 0;
+		drive = dual = false;
+		sr_out = 0xff;
+	}
+	else if(cs && !cs_d)
+		end();
+	
+	if(!cs && (sclk != sclk_d))
+	{
+		if(sclk)
+			rise(mosi);
+		else
+			fall();
+	}
+	
+	sclk_d = sclk;
+	cs_d = cs;
+	
+	miso = (!cs && drive) ? (sr_out>>7)&1 : 1;
+	io0 = (sr_out>>6)&1;
+	io0_oe = !cs && drive && dual;
+}
+
+/*
+ * command, address & program data in on rising SCLK
+ */
+void SimFlash::rise(bool mosi)
+{
+	uint32_t a;
+	
+	sr_in = (sr_in<<1) | mosi;
+	bits++;
+	
+	if(bits == 8)
+	{
+		cmd = sr_in;
+		ok = wel;
+		if(busy() && (cmd != 0x05))
+			cmd = 0xff;
+	}
+	else if((bits > 8) && (bits <= 32))
+		addr = ((addr<<1) | mosi) & 0xffffff;
+	else if((cmd == 0x02) && ok && !(bits & 7))
+	{
+		// program clears bits, address wraps within the page
+		a = addr % mem.size();
+		mem[a] &= sr_in;
+		addr = (addr & ~0xff) | ((addr + 1) & 0xff);
+		dirty = true;
+	}
+}
+
+/*
+ * read data out on falling SCLK
+ */
+void SimFlash::fall(void)
+{
+	if((cmd == 0x3B) && (bits >= 40))
+	{
+		// two bits per clock, IO1 carries the odd bits
+		dual = drive = true;
+		if(!(bits & 3))
+		{
+			sr_out = mem[addr++ % mem.size()];
+			reads++;
+		}
+		else
+			sr_out = (sr_out<<2) | 3;
+	}
+	else if(!(bits & 7))
+	{
+		// load next byte
+		drive = false;
+		switch(cmd)
+		{
+			case 0x03:
+			case 0x0B:
+				if(bits >= ((cmd == 0x03) ? 32u : 40u))
+				{
+					sr_out = mem[addr++ % mem.size()];
+					reads++;
+					drive = true;
+				}
+				break;
+			
+			case 0x5A:
+				if(bits >= 40)
+				{
+					sr_out = sfdp[addr++ & 0xff];
+					drive = true;
+				}
+				break;
+			
+			case 0x05:
+				// repeats for as long as CS is held
+				sr_out = (wel<<1) | busy();
+				drive = true;
+				break;
+			
+			case 0x9F:
+				if(bits < 32)
+				{
+					sr_out = FLASH_ID >> (8*(3-bits/8));
+					drive = true;
+				}
+				break;
+		}
+	}
+	else
+		sr_out = (sr_out<<1) | 1;
+}
+
+void SimFlash::erase(uint32_t size, uint32_t t)
+{
+	uint32_t a;
+	
+	if(ok && (bits == 32))
+	{
+		a = (addr & ~(size - 1)) % mem.size();
+		memset(&mem[a], 0xff, size);
+		wel = false;
+		busy_end = now + t;
+		dirty = true;
+		erases++;
+	}
+}
+
+/*
+ * commands which act when CS rises
+ */
+void SimFlash::end(void)
+{
+	switch(cmd)
+	{
+		case 0x06:
+			if(bits == 8)
+				wel = true;
+			break;
+		
+		case 0x04:
+			if(bits == 8)
+				wel = false;
+			break;
+		
+		case 0x02:
+			if(ok && (bits >= 40) && !(bits & 7))
+			{
+				wel = false;
+				busy_end = now + T_PP;
+				programs++;
+			}
+			break;
+		
+		case 0x20: erase(0x1000, T_SE); break;
+		case 0x52: erase(0x8000, T_BE32); break;
+		case 0xD8: erase(0x10000, T_BE64); break;
+	}
+	cmd = 0xff;
+}
@@ -0,0 +1,43 @@
+/*
+ * sim_flash.h - file-backed SPI flash model for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ */
+
+#ifndef __sim_flash__
+#define __sim_flash__
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+
+class SimFlash
+{
+public:
+	SimFlash(uint32_t size = 1<<24);
+	bool load(const char *name, uint32_t addr);
+	bool save(void);
+	void tick(uint64_t clk, bool sclk, bool cs, bool mosi, bool &miso,
+		bool &io0, bool &io0_oe);
+
+	uint32_t reads, programs, erases;
+
+private:
+	void rise(bool mosi);
+	void fall(void);
+	void end(void);
+	void erase(uint32_t size, uint32_t t);
+	bool busy(void) { return now < busy_end; }
+
+	std::vector<uint8_t> mem;
+	uint8_t sfdp[256];
+	std::string file;
+	bool dirty;
+
+	uint64_t now, busy_end;
+	bool sclk_d, cs_d;
+	uint8_t sr_in, cmd, sr_out;
+	uint32_t bits, addr;
+	bool drive, dual, wel, ok;
+};
+
+#endif
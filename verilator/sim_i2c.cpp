@@ -0,0 +1,147 @@
+/*
+ * sim_i2c.cpp - I2C memory for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ *
+ * The C++ side of icarus/i2c_slave.v on I2C0: 256 bytes behind a pointer
+ * set by the first byte of a write. Checks that every byte of a read but
+ * the last is ACKed and the last NACKed before the STOP or repeated START,
+ * counting the violations for the bench report.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sim_i2c.h"
+
+SimI2c::SimI2c(uint8_t a)
+{
+	addr = a;
+	memset(mem, 0, sizeof(mem));
+	ptr = sr = bitn = nrise = 0;
+	scl_d = sda_d = true;
+	active = adr_phase = first = rd = nacked = sda_lo = false;
+	writes = reads = errors = 0;
+}
+
+/*
+ * a read must end in a NACK before the master lets go of the bus. Also
+ * called at the end of a run, since an ACKed last byte can leave SDA held
+ * low so the STOP never shows
+ */
+void SimI2c::end_check(void)
+{
+	if(active && rd && !nacked)
+	{
+		fprintf(stderr, "i2c0: last read byte was ACKed\n");
+		errors++;
+	}
+}
+
+/*
+ * SCL rising - sample
+ */
+void SimI2c::rise(bool sda)
+{
+	if(nacked)
+	{
+		// one rise is the STOP or repeated START, more is a byte
+		if(++nrise == 2)
+		{
+			fprintf(stderr, "i2c0: clocked on after a NACK\n");
+			errors++;
+		}
+	}
+	else if(bitn < 8)
+	{
+		if(!rd)
+			sr = (sr<<1) | sda;
+	}
+	else if(rd && sda)
+	{
+		nacked = true;
+		nrise = 0;
+	}
+	bitn++;
+}
+
+/*
+ * SCL falling - drive
+ */
+void SimI2c::fall(void)
+{
+	if(bitn == 8)
+	{
+		if(rd)
+			sda_lo = false;
+		else if(adr_phase)
+		{
+			// address, ACK only our own
+			adr_phase = false;
+			if((sr>>1) == addr)
+			{
+				sda_lo = true;
+				rd = sr & 1;
+				first = !rd;
+			}
+			else
+				active = false;
+		}
+		else
+		{
+			// pointer then data
+			if(first)
+				ptr = sr;
+			else
+			{
+				mem[ptr++] = sr;
+				writes++;
+			}
+			first = false;
+			sda_lo = true;
+		}
+	}
+	else if(bitn == 9)
+	{
+		bitn = 0;
+		sda_lo = false;
+		if(rd)
+		{
+			sr = mem[ptr++];
+			reads++;
+			sda_lo = !(sr & 0x80);
+		}
+	}
+	else if(rd)
+		sda_lo = !((sr >> (7 - bitn)) & 1);
+}
+
+/*
+ * sample the bus after a system clock, returns true to pull SDA low
+ */
+bool SimI2c::tick(bool scl, bool sda)
+{
+	if(scl && scl_d && (sda != sda_d))
+	{
+		end_check();
+		if(!sda)
+		{
+			// START or repeated START
+			active = adr_phase = true;
+			rd = nacked = false;
+			bitn = 0;
+		}
+		else
+		{
+			// STOP
+			active = false;
+			sda_lo = false;
+		}
+	}
+	else if(active && scl && !scl_d)
+		rise(sda);
+	else if(active && !nacked && !scl && scl_d)
+		fall();
+	scl_d = scl;
+	sda_d = sda;
+	
+	return sda_lo;
+}
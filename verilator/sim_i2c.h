@@ -0,0 +1,31 @@
+/*
+ * sim_i2c.h - I2C memory for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ */
+
+#ifndef __sim_i2c__
+#define __sim_i2c__
+
+#include <stdint.h>
+
+class SimI2c
+{
+public:
+	SimI2c(uint8_t addr);
+	bool tick(bool scl, bool sda);
+	void end_check(void);
+
+	uint32_t writes, reads, errors;
+
+private:
+	void rise(bool sda);
+	void fall(void);
+
+	uint8_t addr;
+	uint8_t mem[256];
+	uint8_t ptr, sr, bitn, nrise;
+	bool scl_d, sda_d;
+	bool active, adr_phase, first, rd, nacked, sda_lo;
+};
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * sim_lcd.cpp - ILI9341 model for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ *
+ * Enough of the controller for ili9341.c: CASET, PASET, RAMWR, RAMWRC,
+ * MADCTL orientation & BGR, DISPON/OFF and SWRESET, in 16-bit colour on a
+ * mode 0 write-only bus. DC is sampled with the last bit of each byte as
+ * the part does. Other commands and their parameters are ignored.
+ *
+ * GRAM is written out as a PPM at most once per frame period and only
+ * if it changed, in the orientation MADCTL gives the firmware, named
+ * lcd_NNNNN.ppm after the frame number so a run can be made into a video.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "sim_lcd.h"
+
+#define MADCTL_MY 0x80
+#define MADCTL_MX 0x40
+#define MADCTL_MV 0x20
+#define MADCTL_BGR 0x08
+
+SimLcd::SimLcd(const char *d, uint32_t clks)
+{
+	dir = d ? d : "";
+	frame_clks = clks;
+	next_frame = clks;
+	dirty = false;
+	frames = cmds = pixels = 0;
+	sclk_d = false;
+	sr = nbits = 0;
+	cmd = madctl = 0;
+	narg = 0;
+	xs = ys = x = y = hi = 0;
+	xe = LCD_W-1;
+	ye = LCD_H-1;
+	on = false;
+	memset(gram, 0, sizeof(gram));
+}
+
+/*
+ * sample the pins after a system clock
+ */
+void SimLcd::tick(uint64_t clk, bool sclk, bool cs, bool mosi, bool dc)
+{
+	if(cs)
+		nbits = 0;
+	else if(sclk && !sclk_d)
+	{
+		sr = (sr<<1) | mosi;
+		if(++nbits == 8)
+		{
+			nbits = 0;
+			byte(sr, dc);
+		}
+	}
+	sclk_d = sclk;
+	
+	if(clk >= next_frame)
+	{
+		next_frame += frame_clks;
+		if(dirty && !dir.empty())
+			save();
+		dirty = false;
+	}
+}
+
+/*
+ * write at the current address in MADCTL's orientation
+ */
+void SimLcd::pixel(uint16_t c)
+{
+	uint16_t px, py;
+	
+	px = (madctl & MADCTL_MV) ? y : x;
+	py = (madctl & MADCTL_MV) ? x : y;
+	if(madctl & MADCTL_MX)
+		px = LCD_W-1 - px;
+	if(madctl & MADCTL_MY)
+		py = LCD_H-1 - py;
+	if((px < LCD_W) && (py < LCD_H))
+		gram[py][px] = c;
+	pixels++;
+	dirty = true;
+	
+	if(x++ >= xe)
+	{
+		x = xs;
+		if(y++ >= ye)
+			y = ys;
+	}
+}
+
+void SimLcd::byte(uint8_t d, bool dc)
+{
+	if(!dc)
+	{
+		cmd = d;
+		narg = 0;
+		cmds++;
+		switch(cmd)
+		{
+			case 0x01:				// SWRESET
+				madctl = 0;
+				on = false;
+				break;
+			
+			case 0x28:				// DISPOFF
+			case 0x29:				// DISPON
+				on = cmd & 1;
+				dirty = true;
+				break;
+			
+			case 0x2C:				// RAMWR
+				x = xs;
+				y = ys;
+				break;
+		}
+		return;
+	}
+	
+	switch(cmd)
+	{
+		case 0x2A:					// CASET
+			switch(narg)
+			{
+				case 0: xs = d<<8; break;
+				case 1: xs |= d; break;
+				case 2: xe = d<<8; break;
+				case 3: xe |= d; break;
+			}
+			break;
+		
+		case 0x2B:					// PASET
+			switch(narg)
+			{
+				case 0: ys = d<<8; break;
+				case 1: ys |= d; break;
+				case 2: ye = d<<8; break;
+				case 3: ye |= d; break;
+			}
+			break;
+		
+		case 0x36:					// MADCTL
+			if(!narg)
+				madctl = d;
+			break;
+		
+		case 0x2C:					// RAMWR
+		case 0x3C:					// RAMWRC
+			if(narg & 1)
+				pixel((hi<<8) | d);
+			else
+				hi = d;
+			break;
+	}
+	narg++;
+}
+
+/*
+ * PPM of what the panel shows, black while the display is off. Modules
+ * are wired BGR, so with the MADCTL bit set RGB565 shows as written.
+ */
+void SimLcd::save(void)
+{
+	char name[512];
+	uint8_t rgb[3];
+	uint16_t c, w, h, px, py, i, j;
+	FILE *fp;
+	
+	w = (madctl & MADCTL_MV) ? LCD_H : LCD_W;
+	h = (madctl & MADCTL_MV) ? LCD_W : LCD_H;
+	snprintf(name, sizeof(name), "%s/lcd_%05u.ppm", dir.c_str(), frames++);
+	if(!(fp = fopen(name, "wb")))
+	{
+		perror(name);
+		dir.clear();
+		return;
+	}
+	
+	fprintf(fp, "P6\n%u %u\n255\n", w, h);
+	for(j=0;j<h;j++)
+		for(i=0;i<w;i++)
+		{
+			px = (madctl & MADCTL_MV) ? j : i;
+			py = (madctl & MADCTL_MV) ? i : j;
+			if(madctl & MADCTL_MX)
+				px = LCD_W-1 - px;
+			if(madctl & MADCTL_MY)
+				py = LCD_H-1 - py;
+			c = on ? gram[py][px] : 0;
+			rgb[0] = ((c>>11) & 0x1f) * 255 / 31;
+			rgb[1] = ((c>>5) & 0x3f) * 255 / 63;
+			rgb[2] = (c & 0x1f) * 255 / 31;
+			if(!(madctl & MADCTL_BGR))
+			{
+				rgb[0] ^= rgb[2];
+				rgb[2] ^= rgb[0];
+				rgb[0] ^= rgb[2];
+			}
+			fwrite(rgb, 1, 3, fp);
+		}
+	fclose(fp);
+}
@@ -0,0 +1,44 @@
+/*
+ * sim_lcd.h - ILI9341 model for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ */
+
+#ifndef __sim_lcd__
+#define __sim_lcd__
+
+#include <stdint.h>
+#include <string>
+
+#define LCD_W 240
+#define LCD_H 320
+
+class SimLcd
+{
+public:
+	SimLcd(const char *dir, uint32_t frame_clks);
+	void tick(uint64_t clk, bool sclk, bool cs, bool mosi, bool dc);
+
+	uint32_t frames, cmds, pixels;
+
+private:
+	void byte(uint8_t d, bool dc);
+	void pixel(uint16_t c);
+	void save(void);
+
+	std::string dir;
+	uint32_t frame_clks;
+	uint64_t next_frame;
+	bool dirty;
+
+	bool sclk_d;
+	uint8_t sr, nbits;
+
+	// controller state
+	uint8_t cmd, madctl;
+	uint32_t narg;
+	uint16_t xs, xe, ys, ye, x, y, hi;
+	bool on;
+	uint16_t gram[LCD_H][LCD_W];
+};
+
+#endif
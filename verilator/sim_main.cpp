@@ -0,0 +1,243 @@
+/*
+ * sim_main.cpp - Verilator harness for the riscv system
+ * 10-17-26 E. Brombaugh
+ *
+ * Clocks sim_top.v and runs the C++ models of the board around it: the
+ * serial port (sim_uart), the SPI flash on SPI0 (sim_flash) and the
+ * ILI9341 on SPI1 with DC on gp_out[30] (sim_lcd), the bench DMA
+ * region's checking slave on SPI1 CS1 (sim_spi) and an I2C memory at
+ * 0x1A on I2C0 (sim_i2c). Decodes the same
+ * bench.h markers as icarus/tb_system.v and prints the same report.
+ *
+ * usage: Vsim_top [-f flash.bin] [-a addr] [-w] [-p] [-l dir] [-r fps]
+ *                 [-c clocks]
+ *  -f  flash image, default flash.bin
+ *  -a  where the image goes in flash, default 0x100000 like icarus. An
+ *      image the size of the flash always loads at 0
+ *  -w  write the whole flash back to the image file on exit if it was
+ *      programmed or erased
+ *  -p  serial port on a pseudo-terminal instead of stdin/stdout
+ *  -l  directory for LCD frames, none written without it
+ *  -r  LCD frame rate, default 60
+ *  -c  stop after this many clocks, default run until ^C
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <memory>
+#include "verilated.h"
+#include "Vsim_top.h"
+#include "sim_uart.h"
+#include "sim_flash.h"
+#include "sim_lcd.h"
+#include "sim_spi.h"
+#include "sim_i2c.h"
+
+#define CLK_HZ 24000000
+#define BENCH_REGIONS 16
+
+static volatile sig_atomic_t quit;
+
+static void stop(int sig)
+{
+	(void)sig;
+	quit = 1;
+}
+
+/* bench.h marker decoder, as tb_system.v */
+typedef struct
+{
+	char name[17];
+	uint32_t runs, chk, bad;
+	uint64_t tot, min, max, t0, f0, fet;
+} bench_region;
+
+static bench_region bench[BENCH_REGIONS];
+
+/*
+ * returns true when the firmware signals the suite is done
+ */
+static bool bench_mark(uint32_t d, uint64_t clk, uint64_t fetches,
+	const SimSpi &dma, SimI2c &i2c)
+{
+	bench_region *b = &bench[(d>>8) & 15];
+	uint64_t t;
+	size_t n;
+	uint32_t bad = 0;
+	
+	switch(d>>28)
+	{
+		case 1:
+			b->t0 = clk;
+			b->f0 = fetches;
+			break;
+		
+		case 2:
+			t = clk - b->t0;
+			if(!b->runs || (t < b->min))
+				b->min = t;
+			if(!b->runs || (t > b->max))
+				b->max = t;
+			b->runs++;
+			b->tot += t;
+			b->fet += fetches - b->f0;
+			break;
+		
+		case 3:
+			n = strlen(b->name);
+			if(n < sizeof(b->name)-1)
+				b->name[n] = d & 0xff;
+			break;
+		
+		case 4:
+			printf("\nbench: %16s %5s %9s %9s %9s %6s\n", "region", "runs",
+				"avg clks", "min", "max", "CPI");
+			for(b=bench;b<&bench[BENCH_REGIONS];b++)
+				if(b->runs)
+					printf("bench: %16s %5u %9llu %9llu %9llu %6.3f\n",
+						b->name, b->runs,
+						(unsigned long long)(b->tot / b->runs),
+						(unsigned long long)b->min,
+						(unsigned long long)b->max,
+						(double)b->tot / b->fet);
+			for(b=bench;b<&bench[BENCH_REGIONS];b++)
+				if(b->bad)
+				{
+					printf("bench: %16s FAILED %u of %u checks\n", b->name,
+						b->bad, b->chk);
+					bad += b->bad;
+				}
+			if(dma.errors)
+			{
+				printf("bench: %16s FAILED %u of %u bytes\n", "spi1 cs1 slave",
+					dma.errors, dma.checked);
+				bad += dma.errors;
+			}
+			i2c.end_check();
+			if(i2c.errors)
+			{
+				printf("bench: %16s FAILED %u bus checks\n", "i2c0 slave",
+					i2c.errors);
+				bad += i2c.errors;
+			}
+			if(!bad)
+				printf("bench: all checks passed\n");
+			return true;
+		
+		case 5:
+			b->chk++;
+			if(!(d & 1))
+				b->bad++;
+			break;
+	}
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	const char *flash_file = "flash.bin", *lcd_dir = 0;
+	uint32_t flash_addr = 0x100000, fps = 60;
+	uint64_t clk, limit = 0, fetches = 0;
+	bool save = false, pty = false, miso = 1, io0 = 0, io0_oe = 0;
+	struct timespec t0, t1;
+	double wall;
+	int opt;
+	
+	while((opt = getopt(argc, argv, "f:a:wpl:r:c:")) != -1)
+		switch(opt)
+		{
+			case 'f': flash_file = optarg; break;
+			case 'a': flash_addr = strtoul(optarg, 0, 0); break;
+			case 'w': save = true; break;
+			case 'p': pty = true; break;
+			case 'l': lcd_dir = optarg; break;
+			case 'r': fps = strtoul(optarg, 0, 0); break;
+			case 'c': limit = strtoull(optarg, 0, 0); break;
+			default:
+				fprintf(stderr, "usage: %s [-f flash.bin] [-a addr] [-w] "
+					"[-p] [-l dir] [-r fps] [-c clocks]\n", argv[0]);
+				return 1;
+		}
+	
+	const std::unique_ptr<VerilatedContext> ctx{new VerilatedContext};
+	ctx->commandArgs(argc, argv);
+	const std::unique_ptr<Vsim_top> top{new Vsim_top{ctx.get()}};
+	SimUart uart(pty);
+	SimFlash flash;
+	SimLcd lcd(lcd_dir, CLK_HZ / (fps ? fps : 60));
+	SimSpi dma;
+	SimI2c i2c(0x1A);
+	
+	if(!flash.load(flash_file, flash_addr))
+		fprintf(stderr, "flash: no %s, starting blank\n", flash_file);
+	if(pty)
+		fprintf(stderr, "uart: %s\n", uart.name());
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+	
+	top->clk24 = 0;
+	top->reset = 1;
+	top->RX = 1;
+	top->spi0_miso_i = 1;
+	top->spi0_io0_i = 0;
+	top->spi0_io0_oe_i = 0;
+	top->spi1_miso_i = 1;
+	top->i2c0_sda_lo_i = 0;
+	top->eval();
+	
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for(clk=0;!quit && !ctx->gotFinish() && (!limit || (clk < limit));clk++)
+	{
+		if(clk == 8)
+			top->reset = 0;
+		
+		top->clk24 = 1;
+		top->eval();
+		
+		// models see the pins just after each rising edge
+		if(top->fetch)
+			fetches++;
+		if(top->bench_stb && bench_mark(top->bench_dat, clk, fetches, dma, i2c))
+			break;
+		top->RX = uart.tick(top->TX, top->baud_div);
+		flash.tick(clk, top->spi0_sclk_o, top->spi0_cs0_o, top->spi0_mosi_o,
+			miso, io0, io0_oe);
+		top->spi0_miso_i = miso;
+		top->spi0_io0_i = io0;
+		top->spi0_io0_oe_i = io0_oe;
+		lcd.tick(clk, top->spi1_sclk_o, top->spi1_cs0_o, top->spi1_mosi_o,
+			(top->gp_out >> 30) & 1);
+		top->spi1_miso_i = dma.tick(top->spi1_sclk_o, top->spi1_cs1_o,
+			top->spi1_mosi_o);
+		top->i2c0_sda_lo_i = i2c.tick(top->i2c0_scl_o, top->i2c0_sda_o);
+		
+		top->clk24 = 0;
+		top->eval();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	top->final();
+	
+	if(save && !flash.save())
+		perror(flash_file);
+	
+	wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+	fprintf(stderr, "\nsim: %llu clocks (%.3f s) in %.2f s, %.2f MHz, "
+		"CPI = %.3f\n", (unsigned long long)clk, (double)clk / CLK_HZ, wall,
+		clk / wall * 1e-6, fetches ? (double)clk / fetches : 0.0);
+	fprintf(stderr, "uart: %u chars out, %u in\n", uart.tx_chars,
+		uart.rx_chars);
+	fprintf(stderr, "flash: %u bytes read, %u programs, %u erases\n",
+		flash.reads, flash.programs, flash.erases);
+	fprintf(stderr, "lcd: %u commands, %u pixels, %u frames saved\n",
+		lcd.cmds, lcd.pixels, lcd.frames);
+	fprintf(stderr, "spi1 cs1: %u transfers, %u bytes, %u errors\n",
+		dma.transfers, dma.checked, dma.errors);
+	fprintf(stderr, "i2c0: %u bytes written, %u read, %u errors\n",
+		i2c.writes, i2c.reads, i2c.errors);
+	
+	return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * sim_spi.cpp - checking SPI slave for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ *
+ * The C++ side of icarus/spi_slave.v with CHECK set, on SPI1 CS1 for
+ * bench.c's DMA region. Mode 0: MOSI is sampled on rising SCLK and MISO
+ * shifts on falling SCLK. Replies with an incrementing byte pattern and
+ * expects byte n of each transfer to be ~n, counting the mismatches.
+ */
+
+#include <stdio.h>
+#include "sim_spi.h"
+
+SimSpi::SimSpi()
+{
+	transfers = checked = errors = 0;
+	sclk_d = false;
+	cs_d = true;
+	rx_sr = tx_sr = tx_next = nbits = 0;
+	nbytes = 0;
+}
+
+/*
+ * sample the pins after a system clock, returns MISO
+ */
+bool SimSpi::tick(bool sclk, bool cs, bool mosi)
+{
+	if(cs)
+	{
+		if(!cs_d && nbytes)
+			transfers++;
+	}
+	else if(cs_d)
+	{
+		// start of transfer
+		nbits = 0;
+		nbytes = 0;
+		tx_sr = tx_next;
+	}
+	else if(sclk && !sclk_d)
+	{
+		rx_sr = (rx_sr<<1) | mosi;
+		if(++nbits == 8)
+		{
+			nbits = 0;
+			checked++;
+			if(rx_sr != (uint8_t)~nbytes)
+			{
+				if(!errors)
+					fprintf(stderr, "spi1 cs1: byte %u is 0x%02X, "
+						"expected 0x%02X\n", nbytes, rx_sr,
+						(uint8_t)~nbytes);
+				errors++;
+			}
+			nbytes++;
+			tx_next++;
+		}
+	}
+	else if(!sclk && sclk_d)
+		tx_sr = nbits ? tx_sr<<1 : tx_next;
+	sclk_d = sclk;
+	cs_d = cs;
+	
+	return cs ? true : (tx_sr >> 7) & 1;
+}
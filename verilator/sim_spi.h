@@ -0,0 +1,25 @@
+/*
+ * sim_spi.h - checking SPI slave for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ */
+
+#ifndef __sim_spi__
+#define __sim_spi__
+
+#include <stdint.h>
+
+class SimSpi
+{
+public:
+	SimSpi();
+	bool tick(bool sclk, bool cs, bool mosi);
+
+	uint32_t transfers, checked, errors;
+
+private:
+	bool sclk_d, cs_d;
+	uint8_t rx_sr, tx_sr, tx_next, nbits;
+	uint32_t nbytes;
+};
+
+#endif
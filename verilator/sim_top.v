@@ -0,0 +1,95 @@
+// sim_top.v - Verilator top level for the riscv system
+// 10-17-26 E. Brombaugh
+//
+// Splits system.v's bidirectional pins into plain inputs and outputs for
+// the C++ models in sim_main.cpp, and brings out the few internal signals
+// the harness reports on.
+
+`default_nettype none
+
+module sim_top(
+	input clk24,				// 24MHz system clock
+	input reset,				// high-true reset
+
+	input RX,					// serial input
+	output TX,					// serial output
+
+	output spi0_sclk_o,			// flash SCLK
+	output spi0_cs0_o,			// flash CS
+	output spi0_mosi_o,			// flash MOSI as driven
+	input spi0_miso_i,			// flash MISO
+	input spi0_io0_i,			// flash IO0 for dual reads
+	input spi0_io0_oe_i,		// flash drives IO0
+
+	output spi1_sclk_o,			// LCD SCLK
+	output spi1_cs0_o,			// LCD CS
+	output spi1_mosi_o,			// LCD MOSI
+	output spi1_cs1_o,			// bench DMA slave CS
+	input spi1_miso_i,			// bench DMA slave MISO
+
+	output i2c0_scl_o,			// I2C0 SCL
+	output i2c0_sda_o,			// I2C0 SDA
+	input i2c0_sda_lo_i,		// I2C memory pulls SDA low
+
+	output [31:0] gp_out,		// general purpose output, [30] LCD DC
+
+	output [15:0] baud_div,		// ACIA baud divisor
+	output fetch,				// instruction fetch this clock
+	output bench_stb,			// bench.h marker write this clock
+	output [31:0] bench_dat		// bench.h marker
+);
+	wire spi0_mosi, spi0_miso, spi0_sclk, spi0_cs0;
+	wire spi1_mosi, spi1_miso, spi1_sclk, spi1_cs0, spi1_cs1;
+	wire i2c0_sda, i2c0_scl, i2c1_sda, i2c1_scl;
+
+	assign spi0_miso = spi0_miso_i;
+	// IO0 turns around for dual reads. Verilator merges this driver with
+	// the SB_IO one inside system.v, so spi0_mosi_o is whichever is enabled
+	assign spi0_mosi = spi0_io0_oe_i ? spi0_io0_i : 1'bz;
+	assign spi0_sclk_o = spi0_sclk;
+	assign spi0_cs0_o = spi0_cs0;
+	assign spi0_mosi_o = spi0_mosi;
+	assign spi1_miso = spi1_miso_i;
+	assign spi1_sclk_o = spi1_sclk;
+	assign spi1_cs0_o = spi1_cs0;
+	assign spi1_mosi_o = spi1_mosi;
+	assign spi1_cs1_o = spi1_cs1;
+	
+	// open drain like the SB_IO pullups in system.v
+	assign i2c0_sda = i2c0_sda_lo_i ? 1'b0 : 1'bz;
+	assign i2c0_scl_o = i2c0_scl;
+	assign i2c0_sda_o = i2c0_sda;
+
+	system uut(
+		.clk24(clk24),
+		.reset(reset),
+		.RX(RX),
+		.TX(TX),
+		.spi0_mosi(spi0_mosi),
+		.spi0_miso(spi0_miso),
+		.spi0_sclk(spi0_sclk),
+		.spi0_cs0(spi0_cs0),
+		.spi0_cs1(),
+		.spi0_cs2(),
+		.spi0_cs3(),
+		.spi1_mosi(spi1_mosi),
+		.spi1_miso(spi1_miso),
+		.spi1_sclk(spi1_sclk),
+		.spi1_cs0(spi1_cs0),
+		.spi1_cs1(spi1_cs1),
+		.spi1_cs2(),
+		.spi1_cs3(),
+		.i2c0_sda(i2c0_sda),
+		.i2c0_scl(i2c0_scl),
+		.i2c1_sda(i2c1_sda),
+		.i2c1_scl(i2c1_scl),
+		.gp_out(gp_out)
+	);
+
+	// the same taps tb_system.v uses for its CPI and bench monitors
+	assign baud_div = uut.uacia.baud_div;
+	assign fetch = uut.mem_valid & uut.mem_ready & uut.mem_instr;
+	assign bench_stb = uut.gpo_sel & uut.mem_ready & uut.mem_addr[2] &
+		|uut.mem_wstrb;
+	assign bench_dat = uut.mem_wdata;
+endmodule
@@ -0,0 +1,166 @@
+/*
+ * sim_uart.cpp - host side of the ACIA for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ *
+ * Decodes TX and drives RX at whatever rate the ACIA's divisor is set to,
+ * so acia_set_baud() just works. The host end is stdin/stdout, with the
+ * terminal put in non-canonical mode, or a pseudo-terminal that a
+ * terminal program or tools/boot_upload.py can open.
+ */
+
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "sim_uart.h"
+
+/* host input is only checked this often while RX is idle */
+#define POLL_CLKS 1024
+
+static struct termios saved;
+
+SimUart::SimUart(bool pty)
+{
+	struct termios t;
+	
+	tx_chars = rx_chars = 0;
+	pty_name[0] = 0;
+	raw = eof = false;
+	tx_d = true;
+	tx_busy = rx_busy = false;
+	tx_t = tx_next = tx_bit = rx_t = 0;
+	tx_sr = rx_sr = 0;
+	poll_cnt = 0;
+	
+	if(pty)
+	{
+		in_fd = posix_openpt(O_RDWR | O_NOCTTY);
+		if((in_fd < 0) || grantpt(in_fd) || unlockpt(in_fd))
+		{
+			perror("uart: pty");
+			exit(1);
+		}
+		strncpy(pty_name, ptsname(in_fd), sizeof(pty_name)-1);
+		tcgetattr(in_fd, &t);
+		cfmakeraw(&t);
+		tcsetattr(in_fd, TCSANOW, &t);
+		fcntl(in_fd, F_SETFL, O_NONBLOCK);
+		out_fd = in_fd;
+	}
+	else
+	{
+		in_fd = 0;
+		out_fd = 1;
+		if(isatty(in_fd) && !tcgetattr(in_fd, &saved))
+		{
+			// keys go straight to the firmware, ^C still stops the sim
+			t = saved;
+			t.c_lflag &= ~(ICANON | ECHO);
+			t.c_iflag &= ~(ICRNL | INLCR);
+			t.c_cc[VMIN] = 0;
+			t.c_cc[VTIME] = 0;
+			tcsetattr(in_fd, TCSANOW, &t);
+			raw = true;
+		}
+	}
+}
+
+SimUart::~SimUart()
+{
+	if(raw)
+		tcsetattr(in_fd, TCSANOW, &saved);
+	if(pty_name[0])
+		close(in_fd);
+}
+
+/*
+ * next byte from the host, or -1
+ */
+int SimUart::poll_host(void)
+{
+	struct pollfd p = {in_fd, POLLIN, 0};
+	uint8_t c;
+	
+	if(eof || (poll(&p, 1, 0) <= 0) || !(p.revents & POLLIN))
+		return -1;
+	
+	switch(read(in_fd, &c, 1))
+	{
+		case 1:
+			return c;
+		
+		case 0:
+			// stdin closed, a pty just has no slave open yet
+			if(!pty_name[0])
+				eof = true;
+			break;
+	}
+	return -1;
+}
+
+/*
+ * one system clock. div is the ACIA's 16x divisor in clocks/16 per bit,
+ * returns the RX pin level.
+ */
+bool SimUart::tick(bool tx, uint16_t div)
+{
+	uint8_t ch;
+	int c;
+	
+	// TX - sample mid-bit from the start bit's falling edge
+	if(tx_busy)
+	{
+		tx_t += 16;
+		if(tx_t >= tx_next)
+		{
+			if(tx_bit < 8)
+				tx_sr = (tx_sr>>1) | (tx<<7);
+			else
+			{
+				ch = tx_sr;
+				if(write(out_fd, &ch, 1) == 1)
+					tx_chars++;
+				tx_busy = false;
+			}
+			tx_bit++;
+			tx_next += div;
+		}
+	}
+	else if(tx_d && !tx)
+	{
+		tx_busy = true;
+		tx_t = 0;
+		tx_next = div + div/2;
+		tx_bit = 0;
+		tx_sr = 0;
+	}
+	tx_d = tx;
+	
+	// RX - start, 8 data, stop
+	if(rx_busy)
+	{
+		rx_t += 16;
+		if(rx_t >= 10*(uint32_t)div)
+			rx_busy = false;
+		else
+			return (rx_sr >> (rx_t/div)) & 1;
+	}
+	else if(++poll_cnt >= POLL_CLKS)
+	{
+		poll_cnt = 0;
+		if((c = poll_host()) >= 0)
+		{
+			rx_sr = 0x200 | (c<<1);
+			rx_t = 0;
+			rx_busy = true;
+			rx_chars++;
+			return 0;
+		}
+	}
+	
+	return 1;
+}
@@ -0,0 +1,35 @@
+/*
+ * sim_uart.h - host side of the ACIA for the Verilator harness
+ * 10-17-26 E. Brombaugh
+ */
+
+#ifndef __sim_uart__
+#define __sim_uart__
+
+#include <stdint.h>
+
+class SimUart
+{
+public:
+	SimUart(bool pty);
+	~SimUart();
+	const char *name(void) { return pty_name; }
+	bool tick(bool tx, uint16_t div);
+
+	uint32_t tx_chars, rx_chars;
+
+private:
+	int poll_host(void);
+
+	int in_fd, out_fd;
+	char pty_name[64];
+	bool raw, eof;
+
+	// TX decoder & RX generator, times in 1/16ths of a clock
+	bool tx_d, tx_busy, rx_busy;
+	uint32_t tx_t, tx_next, tx_bit, rx_t;
+	uint16_t tx_sr, rx_sr;
+	uint32_t poll_cnt;
+};
+
+#endif